@@ -0,0 +1,198 @@
+// compares ways of waiting for ctx_list readers used by grace period:
+// polling with nanosleep and sched_yield against spinning followed by
+// futex sleep; readers are oversubscribed so waiting writer competes with
+// them for CPU; prints CSV to stdout with mean latency of one grace period
+// and CPU time burnt by the whole process per grace period
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <atomic_ops.h>
+
+#include <utils/cacheline.h>
+#include <utils/futex.h>
+
+#define GRACE_PERIODS 2000
+
+// iterations of busy work inside and outside of read-side section
+#define READ_WORK 2000
+#define IDLE_WORK 500
+
+enum _strategy {
+	WAIT_POLL = 0,
+	WAIT_FUTEX = 1
+};
+
+static const char *_strategy_names[] = { "poll", "futex" };
+
+// copy of the reader part of thread context
+typedef struct {
+	AO_t ctr CACHE_ALIGNED;
+	volatile unsigned int waiters;
+} reader_t;
+
+static struct timespec _spin_timeout = {
+	.tv_sec = 0,
+	.tv_nsec = 400
+};
+
+static AO_t _is_running;
+static int _strategy;
+static reader_t *_readers;
+
+inline static double _now_ns( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+inline static double _cpu_ns( void ) {
+	struct rusage ru;
+	getrusage( RUSAGE_SELF, &ru );
+	return ( ru.ru_utime.tv_sec + ru.ru_stime.tv_sec ) * 1e9 +
+		( ru.ru_utime.tv_usec + ru.ru_stime.tv_usec ) * 1e3;
+}
+
+static void _busy( int n ) {
+	for( volatile int i = 0; i < n; ++i );
+}
+
+static void *_reader_main( void *arg ) {
+	reader_t *rd = arg;
+
+	while( AO_load( &_is_running ) ) {
+		AO_store( &( rd->ctr ), rd->ctr + 1 );
+		AO_nop_full();
+
+		_busy( READ_WORK );
+
+		AO_nop_full();
+		AO_store( &( rd->ctr ), rd->ctr + 1 );
+
+		if( _strategy == WAIT_FUTEX ) {
+			AO_nop_full();
+
+			if( AO_int_load( &( rd->waiters ) ) ) {
+				AO_int_store( &( rd->waiters ), 0 );
+				futex_wake_all( &( rd->waiters ) );
+			}
+		}
+
+		_busy( IDLE_WORK );
+	}
+
+	return NULL;
+}
+
+static void _wait_poll( reader_t *rd, AO_t ctr ) {
+	while( AO_load( &( rd->ctr ) ) == ctr ) {
+		nanosleep( &_spin_timeout, NULL );
+
+		if( AO_load( &( rd->ctr ) ) == ctr )
+			sched_yield();
+	}
+}
+
+static void _wait_futex( reader_t *rd, AO_t ctr ) {
+	for( int i = 0; i < FUTEX_SPIN_ITERATIONS; ++i ) {
+		if( AO_load( &( rd->ctr ) ) != ctr )
+			return;
+
+		cpu_relax();
+	}
+
+	for( ;; ) {
+		AO_int_store( &( rd->waiters ), 1 );
+		AO_nop_full();
+
+		if( AO_load( &( rd->ctr ) ) != ctr )
+			return;
+
+		futex_wait( &( rd->waiters ), 1 );
+	}
+}
+
+static void _synchronize( size_t readers_num ) {
+	AO_t ctr;
+
+	AO_nop_full();
+
+	for( size_t i = 0; i < readers_num; ++i ) {
+		ctr = AO_load( &( _readers[ i ].ctr ) );
+
+		if( ! ( ctr & 1 ) )
+			continue;
+
+		if( _strategy == WAIT_FUTEX )
+			_wait_futex( &( _readers[ i ] ), ctr );
+		else
+			_wait_poll( &( _readers[ i ] ), ctr );
+	}
+}
+
+static void _run( size_t readers_num, int strategy ) {
+	pthread_t *threads = malloc( sizeof( pthread_t ) * readers_num );
+	void *mem = NULL;
+
+	posix_memalign( &mem, CACHE_LINE_SIZE, sizeof( reader_t ) * readers_num );
+	_readers = mem;
+
+	for( size_t i = 0; i < readers_num; ++i ) {
+		_readers[ i ].ctr = 0;
+		_readers[ i ].waiters = 0;
+	}
+
+	_strategy = strategy;
+	AO_store_full( &_is_running, 1 );
+
+	for( size_t i = 0; i < readers_num; ++i )
+		pthread_create( &( threads[ i ] ), NULL, _reader_main, &( _readers[ i ] ) );
+
+	double cpu_start = _cpu_ns();
+	double start = _now_ns();
+
+	for( int i = 0; i < GRACE_PERIODS; ++i )
+		_synchronize( readers_num );
+
+	double elapsed = _now_ns() - start;
+	double cpu = _cpu_ns() - cpu_start;
+
+	AO_store_full( &_is_running, 0 );
+
+	for( size_t i = 0; i < readers_num; ++i )
+		pthread_join( threads[ i ], NULL );
+
+	printf( "%zu,%s,%.0f,%.0f\n",
+		readers_num,
+		_strategy_names[ strategy ],
+		elapsed / GRACE_PERIODS,
+		cpu / GRACE_PERIODS
+	);
+
+	free( _readers );
+	free( threads );
+}
+
+int main( void ) {
+	long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+
+	if( cpus < 1 )
+		cpus = 1;
+
+	printf( "nreaders,strategy,grace_period_ns,cpu_ns\n" );
+
+	for( size_t readers_num = 1;
+		readers_num <= ( size_t ) cpus * 4;
+		readers_num *= 2
+	)
+		for( int strategy = WAIT_POLL; strategy <= WAIT_FUTEX; ++strategy )
+			_run( readers_num, strategy );
+
+	return 0;
+}
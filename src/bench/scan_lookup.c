@@ -0,0 +1,116 @@
+// compares membership testing used by _scan: sorted deletion list with
+// binary search per hazard pointer against hashed hazard set probed per
+// deleted pointer; prints CSV to stdout
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <utils/rope.h>
+#include <utils/ptrset.h>
+
+#define ROUNDS 64
+
+static const size_t _hazards_nums[] = { 64, 512, 4096, 32768 };
+static const size_t _deleted_nums[] = { 16, 256, 4096, 65536 };
+
+inline static double _now_ns( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *_fake_ptr( size_t n ) {
+	return ( void* ) ( ( n + 1 ) * 64 );
+}
+
+static double _bench_sort_bsearch( rope_t *deleted,
+	void **hazards,
+	size_t hazards_num
+) {
+	volatile size_t found = 0;
+	sorted_rope_t sorted;
+	double start = _now_ns();
+
+	for( int r = 0; r < ROUNDS; ++r ) {
+		rope_owner_sort( deleted, &sorted );
+
+		for( size_t i = 0; i < hazards_num; ++i )
+			if( rope_owner_find( &sorted, hazards[ i ] ) != NULL )
+				++found;
+	}
+
+	return ( _now_ns() - start ) / ROUNDS;
+}
+
+static double _bench_hash( rope_t *deleted,
+	void **hazards,
+	size_t hazards_num
+) {
+	volatile size_t found = 0;
+	ptrset_t set;
+	rope_ptr_t iter;
+	double start;
+
+	ptrset_init( &set );
+	start = _now_ns();
+
+	for( int r = 0; r < ROUNDS; ++r ) {
+		ptrset_reset( &set, hazards_num );
+
+		for( size_t i = 0; i < hazards_num; ++i )
+			ptrset_insert( &set, hazards[ i ] );
+
+		for( int cont = rope_iterator_create( deleted, &iter );
+			cont;
+			cont = rope_iterator_next( &iter )
+		)
+			if( ptrset_contains( &set, rope_owner_iterator_deref( &iter ) ) )
+				++found;
+	}
+
+	double res = ( _now_ns() - start ) / ROUNDS;
+	ptrset_destroy( &set );
+
+	return res;
+}
+
+int main( void ) {
+	printf( "nhazards,ndel,sort_bsearch_ns,hash_ns\n" );
+
+	for( size_t h = 0;
+		h < sizeof( _hazards_nums ) / sizeof( _hazards_nums[ 0 ] );
+		++h
+	)
+		for( size_t d = 0;
+			d < sizeof( _deleted_nums ) / sizeof( _deleted_nums[ 0 ] );
+			++d
+		) {
+			size_t hazards_num = _hazards_nums[ h ];
+			size_t deleted_num = _deleted_nums[ d ];
+			// hazards and deletions are overlapped by a half of the smaller set
+			size_t overlap = ( ( hazards_num < deleted_num ) ?
+				hazards_num :
+				deleted_num ) / 2;
+
+			void **hazards = malloc( sizeof( void* ) * hazards_num );
+			for( size_t i = 0; i < hazards_num; ++i )
+				hazards[ i ] = _fake_ptr( deleted_num - overlap + i );
+
+			rope_t *deleted = rope_create();
+			for( size_t i = 0; i < deleted_num; ++i )
+				rope_owner_put( deleted, _fake_ptr( deleted_num - i - 1 ) );
+
+			printf( "%zu,%zu,%.0f,%.0f\n",
+				hazards_num,
+				deleted_num,
+				_bench_sort_bsearch( deleted, hazards, hazards_num ),
+				_bench_hash( deleted, hazards, hazards_num )
+			);
+
+			rope_destroy( deleted );
+			free( hazards );
+		}
+
+	return 0;
+}
@@ -0,0 +1,567 @@
+// throughput of lock-free workloads built on the reclaimer; every run is
+// printed as one CSV line or JSON object to stdout
+//
+// usage: throughput [-w stack|list] [-m hp|ebr|eras|leak] [-t 1,2,4,...]
+//                   [-r read percent] [-b collect interval] [-n list length]
+//                   [-d duration ms] [-f csv|json]
+//
+// stack: Treiber stack; reads peek at the top, writes push or pop
+// list: traversal of a linked list with hand-over-hand protection; writes
+//       replace value object of a random node and retire the old one
+// queue: Michael-Scott queue from containers; every operation is either
+//        enqueue or dequeue, read percent is ignored; not available in
+//        leak mode
+// leak: the same workloads with plain loads and without reclamation;
+//       baseline for the cost of protection
+// collect interval: reclaim_collect is forced every that many retirements
+//       of a thread (0 means reclamation is left to thresholds); time spent
+//       in it is reported as scan time
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <atomic_ops.h>
+
+#include <reclaim/reclaim.h>
+#include <containers/msqueue.h>
+
+#define MAX_THREADS_NUMS 16
+#define STACK_PREFILL 1024
+
+enum _workload {
+	WORKLOAD_STACK = 0,
+	WORKLOAD_LIST = 1,
+	WORKLOAD_QUEUE = 2
+};
+
+enum _mode {
+	MODE_HP = 0,
+	MODE_EBR = 1,
+	MODE_ERAS = 2,
+	MODE_LEAK = 3
+};
+
+static const char *_workload_names[] = { "stack", "list", "queue" };
+static const char *_mode_names[] = { "hp", "ebr", "eras", "leak" };
+
+static const int _mode_flags[] = {
+	RECLAIM_MODE_HAZARD_POINTERS,
+	RECLAIM_MODE_EPOCHS,
+	RECLAIM_MODE_ERAS,
+	0
+};
+
+typedef struct _node_t {
+	struct _node_t *next;
+	struct _node_t *value;
+	size_t payload;
+} node_t;
+
+static struct {
+	int workload;
+	int mode;
+	size_t threads_nums[ MAX_THREADS_NUMS ];
+	size_t threads_nums_num;
+	unsigned read_pct;
+	size_t collect_every;
+	size_t list_len;
+	unsigned duration_ms;
+	int is_json;
+} _cfg = {
+	.workload = WORKLOAD_STACK,
+	.mode = MODE_HP,
+	.threads_nums = { 1 },
+	.threads_nums_num = 1,
+	.read_pct = 50,
+	.collect_every = 0,
+	.list_len = 64,
+	.duration_ms = 1000,
+	.is_json = 0
+};
+
+static reclaimer_t *_reclaimer;
+static node_t *_head;
+static msqueue_t *_queue;
+static AO_t _is_running;
+static pthread_barrier_t _start;
+
+typedef struct {
+	pthread_t thread;
+	unsigned seed;
+	size_t ops;
+	size_t retired;
+	size_t collects;
+	double collect_ns;
+} worker_t;
+
+inline static double _now_ns( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// links held by the node are dropped when it's terminated; the second call
+// for the same node finds them empty
+static void _node_terminate( void *ptr, int is_concurrent ) {
+	node_t *node = ptr;
+
+	( void ) is_concurrent;
+
+	if( _cfg.mode == MODE_HP ) {
+		reclaim_store_link( NULL, ( void** ) &( node->next ), NULL );
+		reclaim_store_link( NULL, ( void** ) &( node->value ), NULL );
+	}
+}
+
+// nodes never point to deleted nodes for long in these workloads
+static void _node_clean_up( void *ptr ) {
+	( void ) ptr;
+}
+
+// links are cleared since storing into them drops the previous value
+inline static node_t *_alloc( thread_ctx_t *ctx ) {
+	node_t *node = ( _cfg.mode == MODE_LEAK ) ?
+		malloc( sizeof( node_t ) ) :
+		reclaim_alloc( ctx );
+
+	node->next = NULL;
+	node->value = NULL;
+
+	return node;
+}
+
+inline static node_t *_deref( thread_ctx_t *ctx, node_t **link ) {
+	if( _cfg.mode == MODE_LEAK )
+		return ( node_t* ) AO_load( ( AO_t* ) link );
+
+	return reclaim_deref_link( ctx, ( void** ) link );
+}
+
+inline static void _release( thread_ctx_t *ctx, node_t *node ) {
+	if( _cfg.mode == MODE_HP )
+		reclaim_release_link( ctx, node );
+}
+
+inline static int _cas( thread_ctx_t *ctx,
+	node_t **where,
+	node_t *old,
+	node_t *new_node
+) {
+	if( _cfg.mode == MODE_LEAK )
+		return AO_compare_and_swap_full( ( AO_t* ) where,
+			( AO_t ) old,
+			( AO_t ) new_node
+		);
+
+	return reclaim_compare_and_swap_link( ctx,
+		( void** ) where,
+		old,
+		new_node
+	);
+}
+
+inline static void _store( thread_ctx_t *ctx, node_t **where, node_t *link ) {
+	if( _cfg.mode == MODE_LEAK )
+		*where = link;
+	else
+		reclaim_store_link( ctx, ( void** ) where, link );
+}
+
+static void _retire( thread_ctx_t *ctx, worker_t *w, node_t *node ) {
+	if( _cfg.mode == MODE_LEAK )
+		return;
+
+	reclaim_free( ctx, node );
+
+	if( ( _cfg.collect_every > 0 ) &&
+		( ( ++( w->retired ) % _cfg.collect_every ) == 0 )
+	) {
+		double start = _now_ns();
+		reclaim_collect( ctx );
+		w->collect_ns += _now_ns() - start;
+		++( w->collects );
+	}
+}
+
+inline static void _section_enter( thread_ctx_t *ctx ) {
+	if( ( _cfg.mode == MODE_EBR ) || ( _cfg.mode == MODE_ERAS ) )
+		reclaim_enter( ctx );
+}
+
+inline static void _section_exit( thread_ctx_t *ctx ) {
+	if( ( _cfg.mode == MODE_EBR ) || ( _cfg.mode == MODE_ERAS ) )
+		reclaim_exit( ctx );
+}
+
+static void _stack_push( thread_ctx_t *ctx, node_t *node ) {
+	node_t *top;
+
+	for( ;; ) {
+		top = _deref( ctx, &_head );
+		_store( ctx, &( node->next ), top );
+
+		if( _cas( ctx, &_head, top, node ) )
+			break;
+
+		_release( ctx, top );
+	}
+
+	_release( ctx, top );
+	_release( ctx, node );
+}
+
+static node_t *_stack_pop( thread_ctx_t *ctx ) {
+	node_t *top, *next;
+
+	for( ;; ) {
+		top = _deref( ctx, &_head );
+
+		if( top == NULL ) {
+			_release( ctx, top );
+			return NULL;
+		}
+
+		next = _deref( ctx, &( top->next ) );
+
+		if( _cas( ctx, &_head, top, next ) ) {
+			_release( ctx, next );
+			return top;
+		}
+
+		_release( ctx, next );
+		_release( ctx, top );
+	}
+}
+
+static void _stack_op( thread_ctx_t *ctx, worker_t *w, int is_read ) {
+	node_t *node;
+
+	_section_enter( ctx );
+
+	if( is_read ) {
+		node = _deref( ctx, &_head );
+
+		if( node != NULL )
+			( void ) *( volatile size_t* ) &( node->payload );
+
+		_release( ctx, node );
+	} else if( rand_r( &( w->seed ) ) & 1 ) {
+		node = _alloc( ctx );
+		node->payload = w->ops;
+		_stack_push( ctx, node );
+	} else if( ( node = _stack_pop( ctx ) ) != NULL )
+		_retire( ctx, w, node );
+
+	_section_exit( ctx );
+}
+
+static void _list_op( thread_ctx_t *ctx, worker_t *w, int is_read ) {
+	size_t target = is_read ?
+		_cfg.list_len :
+		( size_t ) rand_r( &( w->seed ) ) % _cfg.list_len;
+	node_t *cur, *next, *value;
+	size_t sum = 0;
+
+	_section_enter( ctx );
+
+	cur = _deref( ctx, &_head );
+
+	for( size_t i = 0; ( cur != NULL ) && ( i < target ); ++i ) {
+		value = _deref( ctx, &( cur->value ) );
+		sum += value->payload;
+		_release( ctx, value );
+
+		next = _deref( ctx, &( cur->next ) );
+		_release( ctx, cur );
+		cur = next;
+	}
+
+	if( ! is_read && ( cur != NULL ) ) {
+		node_t *fresh = _alloc( ctx );
+		fresh->payload = sum;
+
+		value = _deref( ctx, &( cur->value ) );
+
+		// retirement releases protection of the retired object
+		if( _cas( ctx, &( cur->value ), value, fresh ) ) {
+			_retire( ctx, w, value );
+			_release( ctx, fresh );
+		} else {
+			_release( ctx, value );
+			_retire( ctx, w, fresh );
+		}
+	}
+
+	_release( ctx, cur );
+	_section_exit( ctx );
+}
+
+static void _queue_op( worker_t *w ) {
+	void *value;
+
+	if( rand_r( &( w->seed ) ) & 1 )
+		msqueue_enqueue( _queue, ( void* ) ( w->ops + 1 ) );
+	else
+		msqueue_dequeue( _queue, &value );
+}
+
+static void *_worker_main( void *arg ) {
+	worker_t *w = arg;
+	thread_ctx_t *ctx = ( _cfg.mode == MODE_LEAK ) ?
+		NULL :
+		reclaim_get_context( _reclaimer );
+
+	pthread_barrier_wait( &_start );
+
+	while( AO_load( &_is_running ) ) {
+		int is_read = ( unsigned ) rand_r( &( w->seed ) ) % 100 < _cfg.read_pct;
+
+		if( _cfg.workload == WORKLOAD_STACK )
+			_stack_op( ctx, w, is_read );
+		else if( _cfg.workload == WORKLOAD_LIST )
+			_list_op( ctx, w, is_read );
+		else
+			_queue_op( w );
+
+		++( w->ops );
+	}
+
+	return NULL;
+}
+
+// spine of the list is never retired; only value objects are replaced
+static void _prefill( thread_ctx_t *ctx ) {
+	size_t num = ( _cfg.workload == WORKLOAD_STACK ) ?
+		STACK_PREFILL :
+		_cfg.list_len;
+
+	_head = NULL;
+
+	for( size_t i = 0; i < num; ++i ) {
+		node_t *node = _alloc( ctx );
+		node->payload = i;
+
+		if( _cfg.workload == WORKLOAD_LIST ) {
+			node_t *value = _alloc( ctx );
+			value->payload = i;
+			_store( ctx, &( node->value ), value );
+			_release( ctx, value );
+		}
+
+		_store( ctx, &( node->next ), _head );
+		_store( ctx, &_head, node );
+		_release( ctx, node );
+	}
+}
+
+static void _print_result( size_t threads_num,
+	double elapsed_ns,
+	const worker_t *workers
+) {
+	size_t ops = 0, collects = 0;
+	double collect_ns = 0;
+	reclaim_stats_t stats;
+
+	memset( &stats, 0, sizeof( reclaim_stats_t ) );
+
+	for( size_t i = 0; i < threads_num; ++i ) {
+		ops += workers[ i ].ops;
+		collects += workers[ i ].collects;
+		collect_ns += workers[ i ].collect_ns;
+	}
+
+	if( _reclaimer != NULL )
+		stats = reclaim_get_stats( _reclaimer );
+
+	double mops = ops / ( elapsed_ns / 1e3 );
+	double collect_mean = ( collects > 0 ) ? collect_ns / collects : 0;
+
+	if( _cfg.is_json )
+		printf( "{\"workload\":\"%s\",\"mode\":\"%s\",\"threads\":%zu,"
+			"\"read_pct\":%u,\"collect_every\":%zu,\"list_len\":%zu,"
+			"\"duration_ms\":%.0f,\"ops\":%zu,\"mops\":%.3f,"
+			"\"retired\":%zu,\"reclaimed\":%zu,\"scans\":%zu,"
+			"\"collect_ns\":%.0f,\"backlog_peak\":%zu,"
+			"\"hazards_peak\":%zu}\n",
+			_workload_names[ _cfg.workload ],
+			_mode_names[ _cfg.mode ],
+			threads_num,
+			_cfg.read_pct,
+			_cfg.collect_every,
+			_cfg.list_len,
+			elapsed_ns / 1e6,
+			ops,
+			mops,
+			stats.retired,
+			stats.reclaimed,
+			stats.scans,
+			collect_mean,
+			stats.backlog_peak,
+			stats.hazards_peak
+		);
+	else
+		printf( "%s,%s,%zu,%u,%zu,%zu,%.0f,%zu,%.3f,%zu,%zu,%zu,%.0f,%zu,%zu\n",
+			_workload_names[ _cfg.workload ],
+			_mode_names[ _cfg.mode ],
+			threads_num,
+			_cfg.read_pct,
+			_cfg.collect_every,
+			_cfg.list_len,
+			elapsed_ns / 1e6,
+			ops,
+			mops,
+			stats.retired,
+			stats.reclaimed,
+			stats.scans,
+			collect_mean,
+			stats.backlog_peak,
+			stats.hazards_peak
+		);
+
+	fflush( stdout );
+}
+
+static void _run( size_t threads_num ) {
+	worker_t *workers = calloc( threads_num, sizeof( worker_t ) );
+	thread_ctx_t *ctx = NULL;
+
+	_reclaimer = NULL;
+
+	if( _cfg.workload == WORKLOAD_QUEUE ) {
+		_queue = msqueue_create( _mode_flags[ _cfg.mode ] );
+		_reclaimer = _queue->reclaimer;
+
+		for( size_t i = 0; i < STACK_PREFILL; ++i )
+			msqueue_enqueue( _queue, ( void* ) ( i + 1 ) );
+	} else if( _cfg.mode != MODE_LEAK ) {
+		_reclaimer = reclaim_init( _node_terminate,
+			_node_clean_up,
+			sizeof( node_t ),
+			alignof( node_t ),
+			_mode_flags[ _cfg.mode ]
+		);
+		ctx = reclaim_get_context( _reclaimer );
+	}
+
+	if( _cfg.workload != WORKLOAD_QUEUE )
+		_prefill( ctx );
+
+	AO_store_full( &_is_running, 1 );
+	pthread_barrier_init( &_start, NULL, threads_num + 1 );
+
+	for( size_t i = 0; i < threads_num; ++i ) {
+		workers[ i ].seed = ( unsigned ) i * 7919 + 1;
+		pthread_create( &( workers[ i ].thread ),
+			NULL,
+			_worker_main,
+			&( workers[ i ] )
+		);
+	}
+
+	struct timespec duration = {
+		.tv_sec = _cfg.duration_ms / 1000,
+		.tv_nsec = ( _cfg.duration_ms % 1000 ) * 1000000l
+	};
+
+	pthread_barrier_wait( &_start );
+	double start = _now_ns();
+	nanosleep( &duration, NULL );
+	AO_store_full( &_is_running, 0 );
+	double elapsed = _now_ns() - start;
+
+	for( size_t i = 0; i < threads_num; ++i )
+		pthread_join( workers[ i ].thread, NULL );
+
+	pthread_barrier_destroy( &_start );
+
+	_print_result( threads_num, elapsed, workers );
+
+	// leaky baseline loses everything on purpose
+	if( _cfg.workload == WORKLOAD_QUEUE )
+		msqueue_destroy( _queue );
+	else if( _reclaimer != NULL ) {
+		reclaim_local_fini( ctx );
+		reclaim_fini( _reclaimer );
+	}
+
+	free( workers );
+}
+
+static void _parse_threads( char *arg ) {
+	_cfg.threads_nums_num = 0;
+
+	for( char *tok = strtok( arg, "," );
+		( tok != NULL ) && ( _cfg.threads_nums_num < MAX_THREADS_NUMS );
+		tok = strtok( NULL, "," )
+	)
+		_cfg.threads_nums[ _cfg.threads_nums_num++ ] = strtoul( tok, NULL, 10 );
+}
+
+static int _lookup( const char * const *names, int num, const char *name ) {
+	for( int i = 0; i < num; ++i )
+		if( strcmp( names[ i ], name ) == 0 )
+			return i;
+
+	fprintf( stderr, "unknown value: %s\n", name );
+	exit( 1 );
+}
+
+int main( int argc, char **argv ) {
+	int opt;
+
+	while( ( opt = getopt( argc, argv, "w:m:t:r:b:n:d:f:" ) ) != -1 )
+		switch( opt ) {
+			case 'w':
+				_cfg.workload = _lookup( _workload_names, 3, optarg );
+				break;
+			case 'm':
+				_cfg.mode = _lookup( _mode_names, 4, optarg );
+				break;
+			case 't':
+				_parse_threads( optarg );
+				break;
+			case 'r':
+				_cfg.read_pct = strtoul( optarg, NULL, 10 );
+				break;
+			case 'b':
+				_cfg.collect_every = strtoul( optarg, NULL, 10 );
+				break;
+			case 'n':
+				_cfg.list_len = strtoul( optarg, NULL, 10 );
+				break;
+			case 'd':
+				_cfg.duration_ms = strtoul( optarg, NULL, 10 );
+				break;
+			case 'f':
+				_cfg.is_json = ( strcmp( optarg, "json" ) == 0 );
+				break;
+			default:
+				fprintf( stderr, "see usage in the header of throughput.c\n" );
+				return 1;
+		}
+
+	if( ( _cfg.workload == WORKLOAD_QUEUE ) && ( _cfg.mode == MODE_LEAK ) ) {
+		fprintf( stderr, "queue workload has no leak mode\n" );
+		return 1;
+	}
+
+	if( _cfg.list_len == 0 )
+		_cfg.list_len = 1;
+
+	if( ! _cfg.is_json )
+		printf( "workload,mode,threads,read_pct,collect_every,list_len,"
+			"duration_ms,ops,mops,retired,reclaimed,scans,collect_ns,"
+			"backlog_peak,hazards_peak\n"
+		);
+
+	for( size_t i = 0; i < _cfg.threads_nums_num; ++i )
+		_run( _cfg.threads_nums[ i ] );
+
+	return 0;
+}
@@ -0,0 +1,509 @@
+#include <containers/hashmap.h>
+#include <reclaim_config.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+// removed node is reachable through the links of other removed nodes
+// which are traversed by lookups so links are reference counted; the
+// lowest bit of the link is the deletion mark of the node it belongs to
+// (Harris and Michael)
+typedef struct _hashmap_node_t {
+	struct _hashmap_node_t *next;
+	// bit-reversed hash; the lowest bit is set for items and cleared for
+	// bucket sentinels so sentinel goes before items of its bucket
+	uint64_t so_key;
+	const void *key;
+	void *value;
+} hashmap_node_t;
+
+#define NODE_IS_MARKED ( ( AO_t ) 1 )
+
+#define LINK_IS_MARKED( link ) ( ( AO_t ) ( link ) & NODE_IS_MARKED )
+#define LINK_MARK( link ) ( ( void* ) ( ( AO_t ) ( link ) | NODE_IS_MARKED ) )
+#define LINK_NODE( link ) ( ( hashmap_node_t* ) RECLAIM_LINK_STRIP( link ) )
+
+#define SO_KEY_IS_ITEM ( ( uint64_t ) 1 )
+
+// node with zero reference counter isn't reachable from other nodes so
+// its own link can be dropped; it lets the successor go
+static void _node_terminate_counted( void *ptr, int is_concurrent ) {
+	( void ) is_concurrent;
+
+	hashmap_node_t *node = ptr;
+
+	reclaim_store_link( NULL, ( void** ) &( node->next ), NULL );
+}
+
+// epochs and eras don't look at reference counters and the successor might
+// be freed already
+static void _node_terminate( void *ptr, int is_concurrent ) {
+	( void ) ptr;
+	( void ) is_concurrent;
+}
+
+// links of removed node aren't redirected; chain of removed nodes is
+// reclaimed from its head as its nodes are terminated one by one
+static void _node_clean_up( void *ptr ) {
+	( void ) ptr;
+}
+
+inline static uint64_t _reverse( uint64_t v ) {
+	v = ( ( v >> 1 ) & 0x5555555555555555ull ) | ( ( v & 0x5555555555555555ull ) << 1 );
+	v = ( ( v >> 2 ) & 0x3333333333333333ull ) | ( ( v & 0x3333333333333333ull ) << 2 );
+	v = ( ( v >> 4 ) & 0x0F0F0F0F0F0F0F0Full ) | ( ( v & 0x0F0F0F0F0F0F0F0Full ) << 4 );
+
+	return __builtin_bswap64( v );
+}
+
+// finalizer of splitmix64; buckets are picked by the low bits of the hash
+// (split ordering needs it) so every bit of the key must reach them while
+// plain multiplication leaves the low bits of aligned pointers at zero
+static size_t _hash_integer( const void *key ) {
+	uint64_t h = ( uint64_t ) ( uintptr_t ) key;
+
+	h = ( h ^ ( h >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+	h = ( h ^ ( h >> 27 ) ) * 0x94D049BB133111EBull;
+
+	return ( size_t ) ( h ^ ( h >> 31 ) );
+}
+
+static int _equals_integer( const void *key1, const void *key2 ) {
+	return key1 == key2;
+}
+
+size_t hashmap_hash_string( const void *key ) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for( const unsigned char *c = key; *c != '\0'; ++c ) {
+		hash ^= *c;
+		hash *= 0x100000001B3ull;
+	}
+
+	return ( size_t ) hash;
+}
+
+int hashmap_equals_string( const void *key1, const void *key2 ) {
+	const char *s1 = key1, *s2 = key2;
+
+	while( ( *s1 != '\0' ) && ( *s1 == *s2 ) ) {
+		++s1;
+		++s2;
+	}
+
+	return *s1 == *s2;
+}
+
+// node isn't reachable by other threads until it's linked so protection
+// given by reclaim_alloc is dropped right away; link left by the previous
+// incarnation of the memory doesn't own a reference anymore hence plain
+// store into it
+inline static hashmap_node_t *_node_create( thread_ctx_t *ctx,
+	uint64_t so_key,
+	const void *key,
+	void *value
+) {
+	hashmap_node_t *node = reclaim_alloc( ctx );
+
+	reclaim_release_link( ctx, node );
+	node->next = NULL;
+	node->so_key = so_key;
+	node->key = key;
+	node->value = value;
+
+	return node;
+}
+
+// node which has never been linked
+inline static void _node_discard( thread_ctx_t *ctx, hashmap_node_t *node ) {
+	reclaim_store_link( ctx, ( void** ) &( node->next ), NULL );
+	reclaim_free( ctx, node );
+}
+
+inline static size_t _segment_of( size_t bucket ) {
+	if( bucket < HASHMAP_SEGMENT_SIZE )
+		return 0;
+
+	return sizeof( size_t ) * 8 -
+		__builtin_clzl( bucket / HASHMAP_SEGMENT_SIZE );
+}
+
+inline static size_t _segment_start( size_t segment ) {
+	return ( segment == 0 ) ? 0 : ( HASHMAP_SEGMENT_SIZE << ( segment - 1 ) );
+}
+
+inline static size_t _segment_size( size_t segment ) {
+	return ( segment == 0 ) ?
+		HASHMAP_SEGMENT_SIZE :
+		( HASHMAP_SEGMENT_SIZE << ( segment - 1 ) );
+}
+
+// returns slot of the bucket; segment is allocated by the first thread
+// touching it and losers of the race free their copies
+static AO_t *_bucket_slot( hashmap_t *m, size_t bucket ) {
+	size_t segment = _segment_of( bucket );
+	AO_t *buckets = ( AO_t* ) AO_load( &( m->segments[ segment ] ) );
+
+	if( buckets == NULL ) {
+		AO_t *fresh = calloc( _segment_size( segment ), sizeof( AO_t ) );
+
+		if( AO_compare_and_swap_full( &( m->segments[ segment ] ),
+			( AO_t ) NULL,
+			( AO_t ) fresh
+		) )
+			buckets = fresh;
+		else {
+			free( fresh );
+			buckets = ( AO_t* ) AO_load( &( m->segments[ segment ] ) );
+		}
+	}
+
+	return &( buckets[ bucket - _segment_start( segment ) ] );
+}
+
+// position in the list found by _list_find; pred is either sentinel or
+// protected node, cur and next are protected
+typedef struct {
+	hashmap_node_t *pred;
+	hashmap_node_t *cur;
+	hashmap_node_t *next;
+} hashmap_window_t;
+
+inline static int _node_matches( hashmap_t *m,
+	hashmap_node_t *node,
+	uint64_t so_key,
+	const void *key
+) {
+	return ( node->so_key == so_key ) &&
+		( ( ! ( so_key & SO_KEY_IS_ITEM ) ) || m->equals( node->key, key ) );
+}
+
+// protections of the window are dropped; sentinel isn't protected
+inline static void _list_window_done( thread_ctx_t *ctx,
+	hashmap_node_t *head,
+	hashmap_window_t *w
+) {
+	reclaim_release_link( ctx, w->next );
+	reclaim_release_link( ctx, w->cur );
+	if( w->pred != head )
+		reclaim_release_link( ctx, w->pred );
+}
+
+// searches for the node starting from the sentinel; marked nodes met on
+// the way are unlinked and retired; returns 1 if the node is found and
+// it's w->cur then; otherwise w->cur is the first node which goes after
+// the key (or NULL) and new node belongs between w->pred and w->cur
+static int _list_find( hashmap_t *m,
+	thread_ctx_t *ctx,
+	hashmap_node_t *head,
+	uint64_t so_key,
+	const void *key,
+	hashmap_window_t *w
+) {
+	void *link;
+
+retry:
+	w->pred = head;
+	w->cur = LINK_NODE( reclaim_deref_link( ctx, ( void** ) &( head->next ) ) );
+	w->next = NULL;
+
+	for( ;; ) {
+		if( w->cur == NULL )
+			return 0;
+
+		link = reclaim_deref_link( ctx, ( void** ) &( w->cur->next ) );
+		w->next = LINK_NODE( link );
+
+		// pred might have been marked or cur might have been unlinked
+		// before cur was protected
+		if( AO_load( ( AO_t* ) &( w->pred->next ) ) != ( AO_t ) w->cur ) {
+			_list_window_done( ctx, head, w );
+			goto retry;
+		}
+
+		if( LINK_IS_MARKED( link ) ) {
+			if( ! reclaim_compare_and_swap_link( ctx,
+				( void** ) &( w->pred->next ),
+				w->cur,
+				w->next
+			) ) {
+				_list_window_done( ctx, head, w );
+				goto retry;
+			}
+
+			// unlinker owns the node; protection of cur is dropped here
+			reclaim_free( ctx, w->cur );
+		} else {
+			if( w->cur->so_key > so_key )
+				return 0;
+
+			if( _node_matches( m, w->cur, so_key, key ) )
+				return 1;
+
+			if( w->pred != head )
+				reclaim_release_link( ctx, w->pred );
+			w->pred = w->cur;
+		}
+
+		w->cur = w->next;
+	}
+}
+
+// returns node which is in the list now: either the given one or its
+// equal which was there before; the given one is discarded in that case
+static hashmap_node_t *_list_insert( hashmap_t *m,
+	thread_ctx_t *ctx,
+	hashmap_node_t *head,
+	hashmap_node_t *node
+) {
+	hashmap_window_t w;
+
+	for( ;; ) {
+		if( _list_find( m, ctx, head, node->so_key, node->key, &w ) ) {
+			hashmap_node_t *found = w.cur;
+
+			_list_window_done( ctx, head, &w );
+			_node_discard( ctx, node );
+			return found;
+		}
+
+		reclaim_store_link( ctx, ( void** ) &( node->next ), w.cur );
+
+		if( reclaim_compare_and_swap_link( ctx,
+			( void** ) &( w.pred->next ),
+			w.cur,
+			node
+		) ) {
+			_list_window_done( ctx, head, &w );
+			return node;
+		}
+
+		_list_window_done( ctx, head, &w );
+	}
+}
+
+// parent of the bucket is the one without the highest bit; its sentinel
+// precedes sentinel of the bucket in the list
+static hashmap_node_t *_bucket_get( hashmap_t *m,
+	thread_ctx_t *ctx,
+	size_t bucket
+) {
+	AO_t *slot = _bucket_slot( m, bucket );
+	hashmap_node_t *sentinel = ( hashmap_node_t* ) AO_load( slot );
+
+	if( sentinel != NULL )
+		return sentinel;
+
+	size_t parent = bucket & ~( ( size_t ) 1 <<
+		( sizeof( size_t ) * 8 - 1 - __builtin_clzl( bucket ) ) );
+
+	sentinel = _list_insert( m,
+		ctx,
+		_bucket_get( m, ctx, parent ),
+		_node_create( ctx, _reverse( bucket ), NULL, NULL )
+	);
+
+	// sentinels are never removed so they don't need protection
+	AO_compare_and_swap_full( slot, ( AO_t ) NULL, ( AO_t ) sentinel );
+
+	return sentinel;
+}
+
+inline static hashmap_node_t *_bucket_of( hashmap_t *m,
+	thread_ctx_t *ctx,
+	size_t hash
+) {
+	return _bucket_get( m, ctx, hash & ( AO_load( &( m->capacity ) ) - 1 ) );
+}
+
+hashmap_t *hashmap_create( hashmap_hash_t hash,
+	hashmap_equals_t equals,
+	int flags
+) {
+	void *mem = NULL;
+	posix_memalign( &mem, CACHE_LINE_SIZE, sizeof( hashmap_t ) );
+
+	hashmap_t *m = mem;
+	m->size = 0;
+	m->capacity = HASHMAP_SEGMENT_SIZE;
+	m->hash = ( hash != NULL ) ? hash : _hash_integer;
+	m->equals = ( equals != NULL ) ? equals : _equals_integer;
+
+	for( size_t i = 0; i < HASHMAP_SEGMENTS; ++i )
+		m->segments[ i ] = ( AO_t ) NULL;
+
+	m->reclaimer = reclaim_init(
+		( ( flags & RECLAIM_MODE_MASK ) == RECLAIM_MODE_HAZARD_POINTERS ) ?
+			_node_terminate_counted :
+			_node_terminate,
+		_node_clean_up,
+		sizeof( hashmap_node_t ),
+		alignof( hashmap_node_t ),
+		flags
+	);
+
+	// sentinel of bucket 0 is the head of the list
+	thread_ctx_t *ctx = reclaim_get_context( m->reclaimer );
+	*_bucket_slot( m, 0 ) = ( AO_t ) _node_create( ctx, 0, NULL, NULL );
+
+	AO_nop_full();
+
+	return m;
+}
+
+// traverses marked nodes without unlinking them; reference counters keep
+// successors of protected node alive so only two nodes are protected
+int hashmap_get( hashmap_t *m, const void *key, void **value ) {
+	assert( m != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( m->reclaimer );
+	size_t hash = m->hash( key );
+	uint64_t so_key = _reverse( hash ) | SO_KEY_IS_ITEM;
+	hashmap_node_t *cur, *next;
+	void *link;
+	int is_found = 0;
+
+	reclaim_enter( ctx );
+
+	cur = LINK_NODE( reclaim_deref_link( ctx,
+		( void** ) &( _bucket_of( m, ctx, hash )->next )
+	) );
+
+	while( ( cur != NULL ) && ( cur->so_key <= so_key ) ) {
+		link = reclaim_deref_link( ctx, ( void** ) &( cur->next ) );
+		next = LINK_NODE( link );
+
+		if( ( ! LINK_IS_MARKED( link ) ) && _node_matches( m, cur, so_key, key ) ) {
+			if( value != NULL )
+				*value = cur->value;
+
+			is_found = 1;
+			reclaim_release_link( ctx, next );
+			break;
+		}
+
+		reclaim_release_link( ctx, cur );
+		cur = next;
+	}
+
+	reclaim_release_link( ctx, cur );
+	reclaim_exit( ctx );
+
+	return is_found;
+}
+
+int hashmap_insert( hashmap_t *m, const void *key, void *value ) {
+	assert( m != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( m->reclaimer );
+	size_t hash = m->hash( key );
+	hashmap_node_t *node;
+
+	reclaim_enter( ctx );
+
+	node = _node_create( ctx, _reverse( hash ) | SO_KEY_IS_ITEM, key, value );
+	int is_inserted =
+		( _list_insert( m, ctx, _bucket_of( m, ctx, hash ), node ) == node );
+
+	reclaim_exit( ctx );
+
+	if( ! is_inserted )
+		return 0;
+
+	size_t size = AO_fetch_and_add1( &( m->size ) ) + 1;
+	size_t capacity = AO_load( &( m->capacity ) );
+
+	// buckets of the doubled table are initialized on demand from their
+	// parents
+	if( ( size > capacity * HASHMAP_LOAD_FACTOR ) &&
+		( capacity < ( ( size_t ) HASHMAP_SEGMENT_SIZE << ( HASHMAP_SEGMENTS - 1 ) ) )
+	)
+		AO_compare_and_swap( &( m->capacity ), capacity, capacity * 2 );
+
+	return 1;
+}
+
+// the node is marked first which removes it logically; physical removal
+// is done either right away or by _list_find of somebody else
+int hashmap_remove( hashmap_t *m, const void *key, void **value ) {
+	assert( m != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( m->reclaimer );
+	size_t hash = m->hash( key );
+	uint64_t so_key = _reverse( hash ) | SO_KEY_IS_ITEM;
+	hashmap_node_t *head;
+	hashmap_window_t w;
+	int is_removed = 0;
+
+	reclaim_enter( ctx );
+
+	head = _bucket_of( m, ctx, hash );
+
+	for( ;; ) {
+		if( ! _list_find( m, ctx, head, so_key, key, &w ) ) {
+			_list_window_done( ctx, head, &w );
+			break;
+		}
+
+		// only the tag changes so reference counters stay intact
+		if( ! reclaim_compare_and_swap_link( ctx,
+			( void** ) &( w.cur->next ),
+			w.next,
+			LINK_MARK( w.next )
+		) ) {
+			_list_window_done( ctx, head, &w );
+			continue;
+		}
+
+		if( value != NULL )
+			*value = w.cur->value;
+
+		is_removed = 1;
+
+		if( reclaim_compare_and_swap_link( ctx,
+			( void** ) &( w.pred->next ),
+			w.cur,
+			w.next
+		) ) {
+			hashmap_node_t *cur = w.cur;
+
+			w.cur = NULL;
+			_list_window_done( ctx, head, &w );
+			reclaim_free( ctx, cur );
+		} else {
+			_list_window_done( ctx, head, &w );
+			_list_find( m, ctx, head, so_key, key, &w );
+			_list_window_done( ctx, head, &w );
+		}
+
+		break;
+	}
+
+	reclaim_exit( ctx );
+
+	if( is_removed )
+		AO_fetch_and_sub1( &( m->size ) );
+
+	return is_removed;
+}
+
+size_t hashmap_size( hashmap_t *m ) {
+	assert( m != NULL );
+
+	return AO_load( &( m->size ) );
+}
+
+// nodes left in the map are released along with the pool of reclaimer
+void hashmap_destroy( hashmap_t *m ) {
+	assert( m != NULL );
+
+	reclaim_fini( m->reclaimer );
+
+	for( size_t i = 0; i < HASHMAP_SEGMENTS; ++i )
+		free( ( void* ) m->segments[ i ] );
+
+	free( m );
+}
@@ -0,0 +1,68 @@
+#ifndef LIBHASHMAP
+#define LIBHASHMAP
+
+#include <stddef.h>
+#include <atomic_ops.h>
+
+#include <utils/cacheline.h>
+#include <reclaim/reclaim.h>
+
+// segments of bucket table; segment 0 holds HASHMAP_SEGMENT_SIZE buckets
+// and segment i > 0 holds HASHMAP_SEGMENT_SIZE * 2^(i-1) of them so the
+// table grows without moving buckets around
+#ifndef HASHMAP_SEGMENT_SIZE
+	#define HASHMAP_SEGMENT_SIZE 64
+#endif
+
+#ifndef HASHMAP_SEGMENTS
+	#define HASHMAP_SEGMENTS 32
+#endif
+
+// average number of items per bucket which makes the table double
+#ifndef HASHMAP_LOAD_FACTOR
+	#define HASHMAP_LOAD_FACTOR 2
+#endif
+
+typedef size_t ( *hashmap_hash_t )( const void *key );
+typedef int ( *hashmap_equals_t )( const void *key1, const void *key2 );
+
+// lock-free map of opaque keys to opaque values (split-ordered list of
+// Shalev and Shavit); all the items live in one sorted list and buckets
+// are shortcuts into it which are initialized lazily on the first use;
+// doubling of the table is a single CAS and nothing is rehashed;
+// insertion and removal protect three nodes at most and lookup protects
+// two of them
+typedef struct {
+	AO_t size CACHE_ALIGNED;
+	AO_t capacity;
+	// arrays of pointers to bucket sentinels; allocated on demand
+	AO_t segments[ HASHMAP_SEGMENTS ] CACHE_ALIGNED;
+	hashmap_hash_t hash;
+	hashmap_equals_t equals;
+	reclaimer_t *reclaimer;
+} hashmap_t;
+
+// keys are owned by the caller and must outlive the items; if hash and
+// equals are NULL then keys are integers casted to pointers; flags are
+// passed to reclaim_init as is
+extern hashmap_t *hashmap_create( hashmap_hash_t hash,
+	hashmap_equals_t equals,
+	int flags
+);
+
+// returns 0 if key isn't in the map
+extern int hashmap_get( hashmap_t *m, const void *key, void **value );
+// inserts item only if key isn't in the map yet; returns 0 otherwise
+extern int hashmap_insert( hashmap_t *m, const void *key, void *value );
+// returns 0 if key isn't in the map
+extern int hashmap_remove( hashmap_t *m, const void *key, void **value );
+// number of items; might be stale under concurrent updates
+extern size_t hashmap_size( hashmap_t *m );
+// map must not be used concurrently
+extern void hashmap_destroy( hashmap_t *m );
+
+// FNV-1a hash and comparison for zero-terminated strings
+extern size_t hashmap_hash_string( const void *key );
+extern int hashmap_equals_string( const void *key1, const void *key2 );
+
+#endif
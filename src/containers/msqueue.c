@@ -0,0 +1,226 @@
+#include <containers/msqueue.h>
+#include <reclaim_config.h>
+
+#include <stdlib.h>
+#include <stdalign.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+// dequeued nodes are never reached through links of other nodes so links
+// are changed with plain CAS; reference counters of nodes stay zero and
+// nodes are freed as soon as they aren't protected
+typedef struct _msqueue_node_t {
+	struct _msqueue_node_t *next;
+	void *value;
+} msqueue_node_t;
+
+// batch of nodes retired at once by msqueue_dequeue_n
+#define DEQUEUE_BATCH POINTERS_NUMBER
+
+static void _node_terminate( void *ptr, int is_concurrent ) {
+	( void ) ptr;
+	( void ) is_concurrent;
+}
+
+static void _node_clean_up( void *ptr ) {
+	( void ) ptr;
+}
+
+// node isn't reachable by other threads until it's enqueued so protection
+// given by reclaim_alloc is dropped right away
+inline static msqueue_node_t *_node_create( thread_ctx_t *ctx, void *value ) {
+	msqueue_node_t *node = reclaim_alloc( ctx );
+
+	reclaim_release_link( ctx, node );
+	node->next = NULL;
+	node->value = value;
+
+	return node;
+}
+
+msqueue_t *msqueue_create( int flags ) {
+	void *mem = NULL;
+	posix_memalign( &mem, CACHE_LINE_SIZE, sizeof( msqueue_t ) );
+
+	msqueue_t *q = mem;
+	q->reclaimer = reclaim_init( _node_terminate,
+		_node_clean_up,
+		sizeof( msqueue_node_t ),
+		alignof( msqueue_node_t ),
+		flags
+	);
+
+	msqueue_node_t *dummy = _node_create(
+		reclaim_get_context( q->reclaimer ),
+		NULL
+	);
+	q->head = q->tail = ( AO_t ) dummy;
+
+	AO_nop_full();
+
+	return q;
+}
+
+// chain is linked after the last node with one CAS; tail might lag behind
+// by several nodes afterwards and it's advanced one by one by anybody who
+// notices that
+static void _enqueue_chain( msqueue_t *q,
+	thread_ctx_t *ctx,
+	msqueue_node_t *first,
+	msqueue_node_t *last
+) {
+	msqueue_node_t *tail;
+	AO_t next;
+
+	reclaim_enter( ctx );
+
+	for( ;; ) {
+		tail = reclaim_deref_link( ctx, ( void** ) &( q->tail ) );
+		next = AO_load( ( AO_t* ) &( tail->next ) );
+
+		if( next != ( AO_t ) NULL )
+			AO_compare_and_swap_full( &( q->tail ), ( AO_t ) tail, next );
+		else if( AO_compare_and_swap_full( ( AO_t* ) &( tail->next ),
+			( AO_t ) NULL,
+			( AO_t ) first
+		) ) {
+			AO_compare_and_swap_full( &( q->tail ),
+				( AO_t ) tail,
+				( AO_t ) last
+			);
+			reclaim_release_link( ctx, tail );
+			break;
+		}
+
+		reclaim_release_link( ctx, tail );
+	}
+
+	reclaim_exit( ctx );
+}
+
+void msqueue_enqueue( msqueue_t *q, void *value ) {
+	assert( q != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( q->reclaimer );
+	msqueue_node_t *node = _node_create( ctx, value );
+
+	_enqueue_chain( q, ctx, node, node );
+}
+
+void msqueue_enqueue_n( msqueue_t *q, void * const *values, size_t n ) {
+	assert( q != NULL );
+
+	if( n == 0 )
+		return;
+
+	thread_ctx_t *ctx = reclaim_get_context( q->reclaimer );
+	msqueue_node_t *first = _node_create( ctx, values[ 0 ] );
+	msqueue_node_t *last = first;
+
+	for( size_t i = 1; i < n; ++i ) {
+		last->next = _node_create( ctx, values[ i ] );
+		last = last->next;
+	}
+
+	_enqueue_chain( q, ctx, first, last );
+}
+
+// returns former dummy node which belongs to the caller now and isn't
+// protected anymore; value is read from the new dummy while it's protected
+static msqueue_node_t *_dequeue_node( msqueue_t *q,
+	thread_ctx_t *ctx,
+	void **value
+) {
+	msqueue_node_t *head, *next;
+	AO_t tail;
+
+	for( ;; ) {
+		head = reclaim_deref_link( ctx, ( void** ) &( q->head ) );
+		tail = AO_load( &( q->tail ) );
+		next = reclaim_deref_link( ctx, ( void** ) &( head->next ) );
+
+		// head might have been dequeued and its next changed before
+		// it was protected
+		if( AO_load( &( q->head ) ) == ( AO_t ) head ) {
+			if( next == NULL ) {
+				reclaim_release_link( ctx, next );
+				reclaim_release_link( ctx, head );
+				return NULL;
+			}
+
+			if( tail == ( AO_t ) head )
+				AO_compare_and_swap_full( &( q->tail ), tail, ( AO_t ) next );
+			else {
+				*value = next->value;
+
+				if( AO_compare_and_swap_full( &( q->head ),
+					( AO_t ) head,
+					( AO_t ) next
+				) ) {
+					reclaim_release_link( ctx, next );
+					reclaim_release_link( ctx, head );
+					return head;
+				}
+			}
+		}
+
+		reclaim_release_link( ctx, next );
+		reclaim_release_link( ctx, head );
+	}
+}
+
+int msqueue_dequeue( msqueue_t *q, void **value ) {
+	assert( q != NULL );
+	assert( value != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( q->reclaimer );
+
+	reclaim_enter( ctx );
+	msqueue_node_t *node = _dequeue_node( q, ctx, value );
+
+	if( node != NULL )
+		reclaim_free( ctx, node );
+
+	reclaim_exit( ctx );
+
+	return node != NULL;
+}
+
+size_t msqueue_dequeue_n( msqueue_t *q, void **values, size_t n ) {
+	assert( q != NULL );
+	assert( values != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( q->reclaimer );
+	void *batch[ DEQUEUE_BATCH ];
+	size_t dequeued = 0, batched = 0;
+	msqueue_node_t *node;
+
+	reclaim_enter( ctx );
+
+	while( ( dequeued < n ) &&
+		( ( node = _dequeue_node( q, ctx, &( values[ dequeued ] ) ) ) != NULL )
+	) {
+		++dequeued;
+		batch[ batched++ ] = node;
+
+		if( batched == DEQUEUE_BATCH ) {
+			reclaim_free_n( ctx, batch, batched );
+			batched = 0;
+		}
+	}
+
+	if( batched > 0 )
+		reclaim_free_n( ctx, batch, batched );
+
+	reclaim_exit( ctx );
+
+	return dequeued;
+}
+
+// nodes left in the queue are released along with the pool of reclaimer
+void msqueue_destroy( msqueue_t *q ) {
+	assert( q != NULL );
+
+	reclaim_fini( q->reclaimer );
+	free( q );
+}
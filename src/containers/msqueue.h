@@ -0,0 +1,31 @@
+#ifndef LIBMSQUEUE
+#define LIBMSQUEUE
+
+#include <stddef.h>
+#include <atomic_ops.h>
+
+#include <utils/cacheline.h>
+#include <reclaim/reclaim.h>
+
+// lock-free MPMC FIFO queue of opaque values (Michael and Scott); head
+// always points to dummy node; nodes are allocated from the reclaimer
+// owned by the queue; enqueue protects one node and dequeue two of them
+typedef struct {
+	AO_t head CACHE_ALIGNED;
+	AO_t tail CACHE_ALIGNED;
+	reclaimer_t *reclaimer CACHE_ALIGNED;
+} msqueue_t;
+
+// flags are passed to reclaim_init as is
+extern msqueue_t *msqueue_create( int flags );
+extern void msqueue_enqueue( msqueue_t *q, void *value );
+// chain of values is linked privately and appended with one CAS
+extern void msqueue_enqueue_n( msqueue_t *q, void * const *values, size_t n );
+// returns 0 if queue is empty
+extern int msqueue_dequeue( msqueue_t *q, void **value );
+// returns number of dequeued values; dequeued nodes are retired at once
+extern size_t msqueue_dequeue_n( msqueue_t *q, void **values, size_t n );
+// queue must not be used concurrently
+extern void msqueue_destroy( msqueue_t *q );
+
+#endif
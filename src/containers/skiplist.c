@@ -0,0 +1,536 @@
+#include <containers/skiplist.h>
+#include <reclaim_config.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+// removed tower is reachable through the links of other removed towers
+// which are traversed by lookups and iterators so links are reference
+// counted; the lowest bit of the link on level i is the deletion mark of
+// level i of the tower it belongs to
+typedef struct _skiplist_node_t {
+	const void *key;
+	void *value;
+	size_t height;
+	// inserter and remover; the one who drops the last claim retires the
+	// tower when it's unlinked from all the levels for sure
+	AO_t claims;
+	struct _skiplist_node_t *next[ SKIPLIST_MAX_LEVEL ];
+} skiplist_node_t;
+
+#define NODE_IS_MARKED ( ( AO_t ) 1 )
+
+#define LINK_IS_MARKED( link ) ( ( AO_t ) ( link ) & NODE_IS_MARKED )
+#define LINK_MARK( link ) ( ( void* ) ( ( AO_t ) ( link ) | NODE_IS_MARKED ) )
+#define LINK_NODE( link ) ( ( skiplist_node_t* ) RECLAIM_LINK_STRIP( link ) )
+
+// position of the key found by _list_find on every level; preds and succs
+// are protected unless they are the head; held lists protections to drop
+typedef struct {
+	skiplist_node_t *preds[ SKIPLIST_MAX_LEVEL ];
+	skiplist_node_t *succs[ SKIPLIST_MAX_LEVEL ];
+	skiplist_node_t *held[ SKIPLIST_MAX_LEVEL * 2 ];
+	size_t held_num;
+} skiplist_window_t;
+
+// tower with zero reference counter isn't reachable from other towers so
+// its own links can be dropped; it lets the successors go
+static void _node_terminate_counted( void *ptr, int is_concurrent ) {
+	( void ) is_concurrent;
+
+	skiplist_node_t *node = ptr;
+
+	for( size_t i = 0; i < node->height; ++i )
+		reclaim_store_link( NULL, ( void** ) &( node->next[ i ] ), NULL );
+}
+
+// epochs and eras don't look at reference counters and the successors
+// might be freed already
+static void _node_terminate( void *ptr, int is_concurrent ) {
+	( void ) ptr;
+	( void ) is_concurrent;
+}
+
+static void _node_clean_up( void *ptr ) {
+	( void ) ptr;
+}
+
+static int _compare_integer( const void *key1, const void *key2 ) {
+	return ( ( uintptr_t ) key1 > ( uintptr_t ) key2 ) -
+		( ( uintptr_t ) key1 < ( uintptr_t ) key2 );
+}
+
+// state of splitmix64 is per thread so inserters don't bounce a shared
+// line; address of the state differs between threads and seeds it
+static __thread uint64_t _height_seed;
+
+inline static size_t _random_height( void ) {
+	if( _height_seed == 0 )
+		_height_seed = ( uint64_t ) ( uintptr_t ) &_height_seed;
+
+	uint64_t z = ( _height_seed += 0x9E3779B97F4A7C15ull );
+
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+	z ^= z >> 31;
+
+	// guard bit caps the height and keeps the argument of ctz non-zero
+	return 1 + __builtin_ctzll( ~z | ( 1ull << ( SKIPLIST_MAX_LEVEL - 1 ) ) );
+}
+
+inline static void _level_raise( skiplist_t *s, size_t height ) {
+	AO_t level;
+
+	do {
+		level = AO_load( &( s->level ) );
+	} while(
+		( level < height ) &&
+		! AO_compare_and_swap_full( &( s->level ), level, height )
+	);
+}
+
+// node isn't reachable by other threads until it's linked so protection
+// given by reclaim_alloc is dropped right away; links left by the previous
+// incarnation of the memory don't own references anymore hence plain
+// stores into them
+inline static skiplist_node_t *_node_create( thread_ctx_t *ctx,
+	const void *key,
+	void *value,
+	size_t height
+) {
+	skiplist_node_t *node = reclaim_alloc( ctx );
+
+	reclaim_release_link( ctx, node );
+	node->key = key;
+	node->value = value;
+	node->height = height;
+	node->claims = 2;
+
+	for( size_t i = 0; i < SKIPLIST_MAX_LEVEL; ++i )
+		node->next[ i ] = NULL;
+
+	return node;
+}
+
+// node which has never been linked
+inline static void _node_discard( thread_ctx_t *ctx, skiplist_node_t *node ) {
+	for( size_t i = 0; i < node->height; ++i )
+		reclaim_store_link( ctx, ( void** ) &( node->next[ i ] ), NULL );
+
+	reclaim_free( ctx, node );
+}
+
+inline static void _node_unclaim( thread_ctx_t *ctx, skiplist_node_t *node ) {
+	if( AO_fetch_and_sub1_full( &( node->claims ) ) == 1 )
+		reclaim_free( ctx, node );
+}
+
+inline static void _window_hold( skiplist_window_t *w, skiplist_node_t *node ) {
+	w->held[ w->held_num++ ] = node;
+}
+
+inline static void _window_release( thread_ctx_t *ctx, skiplist_window_t *w ) {
+	while( w->held_num > 0 )
+		reclaim_release_link( ctx, w->held[ --w->held_num ] );
+}
+
+// descends from the top level and unlinks marked towers met on the way;
+// returns 1 if w->succs[ 0 ] has the key; protections are kept in w
+// until _window_release
+static int _list_find( skiplist_t *s,
+	thread_ctx_t *ctx,
+	const void *key,
+	skiplist_window_t *w
+) {
+	skiplist_node_t *head = s->head, *pred, *curr, *succ;
+	void *link;
+	int is_pred_held;
+	size_t top, i;
+
+retry:
+	w->held_num = 0;
+	top = AO_load( &( s->level ) );
+	pred = head;
+	is_pred_held = 1;
+
+	for( i = top; i < SKIPLIST_MAX_LEVEL; ++i ) {
+		w->preds[ i ] = head;
+		w->succs[ i ] = NULL;
+	}
+
+	for( i = top; i-- > 0; ) {
+		curr = LINK_NODE( reclaim_deref_link( ctx,
+			( void** ) &( pred->next[ i ] )
+		) );
+
+		while( curr != NULL ) {
+			link = reclaim_deref_link( ctx, ( void** ) &( curr->next[ i ] ) );
+			succ = LINK_NODE( link );
+
+			// pred might have been marked or curr might have been unlinked
+			// before curr was protected
+			if( AO_load( ( AO_t* ) &( pred->next[ i ] ) ) != ( AO_t ) curr )
+				goto invalid;
+
+			if( LINK_IS_MARKED( link ) ) {
+				if( ! reclaim_compare_and_swap_link( ctx,
+					( void** ) &( pred->next[ i ] ),
+					curr,
+					succ
+				) )
+					goto invalid;
+
+				reclaim_release_link( ctx, curr );
+				curr = succ;
+				continue;
+			}
+
+			if( s->compare( curr->key, key ) >= 0 ) {
+				reclaim_release_link( ctx, succ );
+				break;
+			}
+
+			if( ! is_pred_held )
+				reclaim_release_link( ctx, pred );
+
+			pred = curr;
+			is_pred_held = 0;
+			curr = succ;
+		}
+
+		if( ! is_pred_held ) {
+			_window_hold( w, pred );
+			is_pred_held = 1;
+		}
+
+		_window_hold( w, curr );
+		w->preds[ i ] = pred;
+		w->succs[ i ] = curr;
+	}
+
+	return ( w->succs[ 0 ] != NULL ) &&
+		( s->compare( w->succs[ 0 ]->key, key ) == 0 );
+
+invalid:
+	reclaim_release_link( ctx, succ );
+	reclaim_release_link( ctx, curr );
+	if( ! is_pred_held )
+		reclaim_release_link( ctx, pred );
+	_window_release( ctx, w );
+	goto retry;
+}
+
+// returns the first node on the bottom level which isn't less than lo;
+// marked towers aren't unlinked; the node is protected
+static skiplist_node_t *_list_seek( skiplist_t *s,
+	thread_ctx_t *ctx,
+	const void *lo
+) {
+	skiplist_node_t *head = s->head, *pred = head, *curr = NULL;
+
+	if( lo == NULL )
+		return LINK_NODE( reclaim_deref_link( ctx,
+			( void** ) &( head->next[ 0 ] )
+		) );
+
+	for( size_t i = AO_load( &( s->level ) ); i-- > 0; ) {
+		curr = LINK_NODE( reclaim_deref_link( ctx,
+			( void** ) &( pred->next[ i ] )
+		) );
+
+		while( ( curr != NULL ) && ( s->compare( curr->key, lo ) < 0 ) ) {
+			if( pred != head )
+				reclaim_release_link( ctx, pred );
+
+			pred = curr;
+			curr = LINK_NODE( reclaim_deref_link( ctx,
+				( void** ) &( curr->next[ i ] )
+			) );
+		}
+
+		if( i > 0 )
+			reclaim_release_link( ctx, curr );
+		else if( pred != head )
+			reclaim_release_link( ctx, pred );
+	}
+
+	return curr;
+}
+
+skiplist_t *skiplist_create( skiplist_compare_t compare, int flags ) {
+	void *mem = NULL;
+	posix_memalign( &mem, CACHE_LINE_SIZE, sizeof( skiplist_t ) );
+
+	skiplist_t *s = mem;
+	s->size = 0;
+	s->level = 1;
+	s->compare = ( compare != NULL ) ? compare : _compare_integer;
+	s->reclaimer = reclaim_init(
+		( ( flags & RECLAIM_MODE_MASK ) == RECLAIM_MODE_HAZARD_POINTERS ) ?
+			_node_terminate_counted :
+			_node_terminate,
+		_node_clean_up,
+		sizeof( skiplist_node_t ),
+		alignof( skiplist_node_t ),
+		flags
+	);
+
+	// head is never removed; its key is never compared
+	s->head = _node_create( reclaim_get_context( s->reclaimer ),
+		NULL,
+		NULL,
+		SKIPLIST_MAX_LEVEL
+	);
+
+	AO_nop_full();
+
+	return s;
+}
+
+int skiplist_get( skiplist_t *s, const void *key, void **value ) {
+	assert( s != NULL );
+
+	skiplist_iter_t it;
+	const void *found;
+	void *tmp;
+
+	skiplist_iter_init( &it, s, key, NULL );
+
+	int is_found = skiplist_iter_next( &it, &found, &tmp ) &&
+		( s->compare( found, key ) == 0 );
+
+	skiplist_iter_fini( &it );
+
+	if( is_found && ( value != NULL ) )
+		*value = tmp;
+
+	return is_found;
+}
+
+// tower is linked on the bottom level first which inserts the item; upper
+// levels are linked one by one afterwards unless the tower is being
+// removed meanwhile
+int skiplist_insert( skiplist_t *s, const void *key, void *value ) {
+	assert( s != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( s->reclaimer );
+	size_t height = _random_height();
+	skiplist_window_t w;
+	skiplist_node_t *node;
+	void *link;
+
+	_level_raise( s, height );
+	reclaim_enter( ctx );
+
+	node = _node_create( ctx, key, value, height );
+
+	for( ;; ) {
+		if( _list_find( s, ctx, key, &w ) ) {
+			_window_release( ctx, &w );
+			_node_discard( ctx, node );
+			reclaim_exit( ctx );
+			return 0;
+		}
+
+		for( size_t i = 0; i < height; ++i )
+			reclaim_store_link( ctx, ( void** ) &( node->next[ i ] ), w.succs[ i ] );
+
+		if( reclaim_compare_and_swap_link( ctx,
+			( void** ) &( w.preds[ 0 ]->next[ 0 ] ),
+			w.succs[ 0 ],
+			node
+		) )
+			break;
+
+		_window_release( ctx, &w );
+	}
+
+	AO_fetch_and_add1( &( s->size ) );
+
+	for( size_t i = 1; i < height; ++i )
+		for( ;; ) {
+			// remover marks links from the top so the tower isn't raised
+			// any more once a mark is seen
+			link = ( void* ) AO_load( ( AO_t* ) &( node->next[ i ] ) );
+
+			if( LINK_IS_MARKED( link ) )
+				goto linked;
+
+			if( ( link != w.succs[ i ] ) &&
+				! reclaim_compare_and_swap_link( ctx,
+					( void** ) &( node->next[ i ] ),
+					link,
+					w.succs[ i ]
+				)
+			)
+				continue;
+
+			if( reclaim_compare_and_swap_link( ctx,
+				( void** ) &( w.preds[ i ]->next[ i ] ),
+				w.succs[ i ],
+				node
+			) )
+				break;
+
+			_window_release( ctx, &w );
+
+			if( ( ! _list_find( s, ctx, key, &w ) ) || ( w.succs[ 0 ] != node ) )
+				goto linked;
+		}
+
+linked:
+	_window_release( ctx, &w );
+
+	// the tower might have been linked on some level after remover
+	// passed it
+	if( LINK_IS_MARKED( AO_load( ( AO_t* ) &( node->next[ 0 ] ) ) ) ) {
+		_list_find( s, ctx, key, &w );
+		_window_release( ctx, &w );
+	}
+
+	_node_unclaim( ctx, node );
+	reclaim_exit( ctx );
+
+	return 1;
+}
+
+int skiplist_remove( skiplist_t *s, const void *key, void **value ) {
+	assert( s != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( s->reclaimer );
+	skiplist_window_t w;
+	skiplist_node_t *node;
+	void *link;
+	int is_removed = 0;
+
+	reclaim_enter( ctx );
+
+	if( ! _list_find( s, ctx, key, &w ) ) {
+		_window_release( ctx, &w );
+		reclaim_exit( ctx );
+		return 0;
+	}
+
+	node = w.succs[ 0 ];
+
+	// only tags change so reference counters stay intact
+	for( size_t i = node->height; i-- > 1; )
+		do {
+			link = ( void* ) AO_load( ( AO_t* ) &( node->next[ i ] ) );
+		} while(
+			( ! LINK_IS_MARKED( link ) ) &&
+			! reclaim_compare_and_swap_link( ctx,
+				( void** ) &( node->next[ i ] ),
+				link,
+				LINK_MARK( link )
+			)
+		);
+
+	do {
+		link = ( void* ) AO_load( ( AO_t* ) &( node->next[ 0 ] ) );
+
+		if( LINK_IS_MARKED( link ) )
+			break;
+
+		is_removed = reclaim_compare_and_swap_link( ctx,
+			( void** ) &( node->next[ 0 ] ),
+			link,
+			LINK_MARK( link )
+		);
+	} while( ! is_removed );
+
+	if( is_removed && ( value != NULL ) )
+		*value = node->value;
+
+	_window_release( ctx, &w );
+
+	// remover's claim keeps the tower from being retired so it doesn't
+	// need protection anymore
+	if( is_removed ) {
+		AO_fetch_and_sub1( &( s->size ) );
+		_list_find( s, ctx, key, &w );
+		_window_release( ctx, &w );
+		_node_unclaim( ctx, node );
+	}
+
+	reclaim_exit( ctx );
+
+	return is_removed;
+}
+
+size_t skiplist_size( skiplist_t *s ) {
+	assert( s != NULL );
+
+	return AO_load( &( s->size ) );
+}
+
+// nodes left in the list are released along with the pool of reclaimer
+void skiplist_destroy( skiplist_t *s ) {
+	assert( s != NULL );
+
+	reclaim_fini( s->reclaimer );
+	free( s );
+}
+
+void skiplist_iter_init( skiplist_iter_t *it,
+	skiplist_t *s,
+	const void *lo,
+	const void *hi
+) {
+	assert( it != NULL );
+	assert( s != NULL );
+
+	it->list = s;
+	it->ctx = reclaim_get_context( s->reclaimer );
+	it->hi = hi;
+
+	reclaim_enter( it->ctx );
+	it->cur = _list_seek( s, it->ctx, lo );
+}
+
+// successor of the current node is protected before the current one is
+// released; marked towers are passed through since their links keep
+// successors alive
+int skiplist_iter_next( skiplist_iter_t *it,
+	const void **key,
+	void **value
+) {
+	assert( it != NULL );
+
+	skiplist_node_t *cur;
+	void *link;
+
+	while( ( cur = it->cur ) != NULL ) {
+		if( ( it->hi != NULL ) && ( it->list->compare( cur->key, it->hi ) >= 0 ) )
+			return 0;
+
+		link = reclaim_deref_link( it->ctx, ( void** ) &( cur->next[ 0 ] ) );
+
+		int is_live = ! LINK_IS_MARKED( link );
+
+		if( is_live ) {
+			if( key != NULL )
+				*key = cur->key;
+			if( value != NULL )
+				*value = cur->value;
+		}
+
+		reclaim_release_link( it->ctx, cur );
+		it->cur = LINK_NODE( link );
+
+		if( is_live )
+			return 1;
+	}
+
+	return 0;
+}
+
+void skiplist_iter_fini( skiplist_iter_t *it ) {
+	assert( it != NULL );
+
+	reclaim_release_link( it->ctx, it->cur );
+	reclaim_exit( it->ctx );
+}
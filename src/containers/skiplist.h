@@ -0,0 +1,76 @@
+#ifndef LIBSKIPLIST
+#define LIBSKIPLIST
+
+#include <stddef.h>
+#include <atomic_ops.h>
+
+#include <utils/cacheline.h>
+#include <reclaim/reclaim.h>
+
+// all the towers have room for the maximum number of levels since
+// the reclaimer allocates instances of one size
+#ifndef SKIPLIST_MAX_LEVEL
+	#define SKIPLIST_MAX_LEVEL 16
+#endif
+
+// returns negative, zero or positive value like strcmp
+typedef int ( *skiplist_compare_t )( const void *key1, const void *key2 );
+
+// lock-free ordered map of opaque keys to opaque values (Fraser, Herlihy
+// and Shavit); removal marks links of the tower from the top to the bottom
+// and the mark of the bottom link decides who removed the item; towers are
+// unlinked by anybody who passes them and retired by the last one of
+// remover and inserter; update protects two nodes per level at most and
+// lookup and iterators protect two nodes at a time
+typedef struct {
+	AO_t size CACHE_ALIGNED;
+	// the highest level which has ever been used
+	AO_t level CACHE_ALIGNED;
+	void *head;
+	skiplist_compare_t compare;
+	reclaimer_t *reclaimer;
+} skiplist_t;
+
+// iterator walks through the bottom level and skips removed items; it
+// holds one hazard between the calls and two of them inside; in
+// RECLAIM_MODE_EPOCHS and RECLAIM_MODE_ERAS it holds critical section
+// from skiplist_iter_init to skiplist_iter_fini
+typedef struct {
+	skiplist_t *list;
+	thread_ctx_t *ctx;
+	void *cur;
+	const void *hi;
+} skiplist_iter_t;
+
+// keys are owned by the caller and must outlive the items; if compare is
+// NULL then keys are unsigned integers casted to pointers; flags are passed
+// to reclaim_init as is
+extern skiplist_t *skiplist_create( skiplist_compare_t compare, int flags );
+
+// returns 0 if key isn't in the list
+extern int skiplist_get( skiplist_t *s, const void *key, void **value );
+// inserts item only if key isn't in the list yet; returns 0 otherwise
+extern int skiplist_insert( skiplist_t *s, const void *key, void *value );
+// returns 0 if key isn't in the list
+extern int skiplist_remove( skiplist_t *s, const void *key, void **value );
+// number of items; might be stale under concurrent updates
+extern size_t skiplist_size( skiplist_t *s );
+// list must not be used concurrently
+extern void skiplist_destroy( skiplist_t *s );
+
+// range is [ lo, hi ); NULL bound means that range is unbounded from
+// that side; items inserted or removed during the walk might be seen or
+// not but keys are returned in ascending order
+extern void skiplist_iter_init( skiplist_iter_t *it,
+	skiplist_t *s,
+	const void *lo,
+	const void *hi
+);
+// returns 0 at the end of the range
+extern int skiplist_iter_next( skiplist_iter_t *it,
+	const void **key,
+	void **value
+);
+extern void skiplist_iter_fini( skiplist_iter_t *it );
+
+#endif
@@ -0,0 +1,179 @@
+#include <containers/treiber.h>
+#include <reclaim_config.h>
+
+#include <stdlib.h>
+#include <stdalign.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+// nodes are never reached through links of other nodes once they are
+// popped so links are changed with plain CAS; reference counters of nodes
+// stay zero and nodes are freed as soon as they aren't protected
+typedef struct _treiber_node_t {
+	struct _treiber_node_t *next;
+	void *value;
+} treiber_node_t;
+
+// batch of nodes retired at once by treiber_pop_n
+#define POP_BATCH POINTERS_NUMBER
+
+static void _node_terminate( void *ptr, int is_concurrent ) {
+	( void ) ptr;
+	( void ) is_concurrent;
+}
+
+static void _node_clean_up( void *ptr ) {
+	( void ) ptr;
+}
+
+treiber_t *treiber_create( int flags ) {
+	void *mem = NULL;
+	posix_memalign( &mem, CACHE_LINE_SIZE, sizeof( treiber_t ) );
+
+	treiber_t *s = mem;
+	s->top = ( AO_t ) NULL;
+	s->reclaimer = reclaim_init( _node_terminate,
+		_node_clean_up,
+		sizeof( treiber_node_t ),
+		alignof( treiber_node_t ),
+		flags
+	);
+
+	AO_nop_full();
+
+	return s;
+}
+
+// node isn't reachable by other threads until it's pushed so protection
+// given by reclaim_alloc is dropped right away
+inline static treiber_node_t *_node_create( thread_ctx_t *ctx, void *value ) {
+	treiber_node_t *node = reclaim_alloc( ctx );
+
+	reclaim_release_link( ctx, node );
+	node->value = value;
+
+	return node;
+}
+
+// ABA can't break push: the only thing which matters is that the top is
+// still the same when the node is linked on it
+inline static void _push_chain( treiber_t *s,
+	treiber_node_t *first,
+	treiber_node_t *last
+) {
+	AO_t top;
+
+	do {
+		top = AO_load( &( s->top ) );
+		last->next = ( treiber_node_t* ) top;
+	} while( ! AO_compare_and_swap_full( &( s->top ), top, ( AO_t ) first ) );
+}
+
+void treiber_push( treiber_t *s, void *value ) {
+	assert( s != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( s->reclaimer );
+	treiber_node_t *node = _node_create( ctx, value );
+
+	_push_chain( s, node, node );
+}
+
+void treiber_push_n( treiber_t *s, void * const *values, size_t n ) {
+	assert( s != NULL );
+
+	if( n == 0 )
+		return;
+
+	thread_ctx_t *ctx = reclaim_get_context( s->reclaimer );
+	treiber_node_t *last = _node_create( ctx, values[ 0 ] );
+	treiber_node_t *first = last;
+
+	for( size_t i = 1; i < n; ++i ) {
+		treiber_node_t *node = _node_create( ctx, values[ i ] );
+		node->next = first;
+		first = node;
+	}
+
+	_push_chain( s, first, last );
+}
+
+// the top is protected so it can't be reused while its next field is
+// read; popped node belongs to the caller and isn't protected anymore
+inline static treiber_node_t *_pop_node( treiber_t *s, thread_ctx_t *ctx ) {
+	treiber_node_t *top;
+
+	for( ;; ) {
+		top = reclaim_deref_link( ctx, ( void** ) &( s->top ) );
+
+		if( top == NULL ) {
+			reclaim_release_link( ctx, top );
+			return NULL;
+		}
+
+		if( AO_compare_and_swap_full( &( s->top ),
+			( AO_t ) top,
+			AO_load( ( AO_t* ) &( top->next ) )
+		) ) {
+			reclaim_release_link( ctx, top );
+			return top;
+		}
+
+		reclaim_release_link( ctx, top );
+	}
+}
+
+int treiber_pop( treiber_t *s, void **value ) {
+	assert( s != NULL );
+	assert( value != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( s->reclaimer );
+
+	reclaim_enter( ctx );
+	treiber_node_t *node = _pop_node( s, ctx );
+
+	if( node != NULL ) {
+		*value = node->value;
+		reclaim_free( ctx, node );
+	}
+
+	reclaim_exit( ctx );
+
+	return node != NULL;
+}
+
+size_t treiber_pop_n( treiber_t *s, void **values, size_t n ) {
+	assert( s != NULL );
+	assert( values != NULL );
+
+	thread_ctx_t *ctx = reclaim_get_context( s->reclaimer );
+	void *batch[ POP_BATCH ];
+	size_t popped = 0, batched = 0;
+	treiber_node_t *node;
+
+	reclaim_enter( ctx );
+
+	while( ( popped < n ) && ( ( node = _pop_node( s, ctx ) ) != NULL ) ) {
+		values[ popped++ ] = node->value;
+		batch[ batched++ ] = node;
+
+		if( batched == POP_BATCH ) {
+			reclaim_free_n( ctx, batch, batched );
+			batched = 0;
+		}
+	}
+
+	if( batched > 0 )
+		reclaim_free_n( ctx, batch, batched );
+
+	reclaim_exit( ctx );
+
+	return popped;
+}
+
+// nodes left in the stack are released along with the pool of reclaimer
+void treiber_destroy( treiber_t *s ) {
+	assert( s != NULL );
+
+	reclaim_fini( s->reclaimer );
+	free( s );
+}
@@ -0,0 +1,30 @@
+#ifndef LIBTREIBER
+#define LIBTREIBER
+
+#include <stddef.h>
+#include <atomic_ops.h>
+
+#include <utils/cacheline.h>
+#include <reclaim/reclaim.h>
+
+// lock-free LIFO stack of opaque values (Treiber); nodes are allocated
+// from the reclaimer owned by the stack; pop protects the only node
+// it dereferences and push protects nothing
+typedef struct {
+	AO_t top CACHE_ALIGNED;
+	reclaimer_t *reclaimer CACHE_ALIGNED;
+} treiber_t;
+
+// flags are passed to reclaim_init as is
+extern treiber_t *treiber_create( int flags );
+extern void treiber_push( treiber_t *s, void *value );
+// values are pushed with one CAS; values[ n - 1 ] ends up on the top
+extern void treiber_push_n( treiber_t *s, void * const *values, size_t n );
+// returns 0 if stack is empty
+extern int treiber_pop( treiber_t *s, void **value );
+// returns number of popped values; popped nodes are retired at once
+extern size_t treiber_pop_n( treiber_t *s, void **values, size_t n );
+// stack must not be used concurrently
+extern void treiber_destroy( treiber_t *s );
+
+#endif
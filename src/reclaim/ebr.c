@@ -0,0 +1,193 @@
+#include <reclaim/ebr.h>
+#include <reclaim_config.h>
+
+#include <assert.h>
+#include <atomic_ops.h>
+
+#include <utils/rope.h>
+#include <reclaim/internal.h>
+
+// lowest bit of thread local epoch word is set while the thread is inside
+// critical section; the rest is the global epoch observed on enter
+#define EBR_ACTIVE ( 1ul )
+#define EBR_BAGS_NUMBER 3
+
+void ebr_ctx_init( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+	assert( ctx->deleted != NULL );
+
+	ctx->ebr.local = 0;
+	ctx->ebr.nesting = 0;
+	ctx->ebr.epoch = AO_load( &( ctx->reclaimer->epoch ) );
+
+	for( AO_t i = 0; i < EBR_BAGS_NUMBER; ++i )
+		ctx->ebr.bags[ i ] = ( i == ( ctx->ebr.epoch % EBR_BAGS_NUMBER ) ) ?
+			ctx->deleted :
+			rope_create();
+}
+
+// clean_up is called for every object of the bag before any of them is
+// terminated so links between objects retired together are still valid
+// for it, as they are for clean-up passes in the other modes
+static void _ebr_free_bag( thread_ctx_t *ctx, rope_t *bag ) {
+	void ( *clean_up )( void *ptr ) = ctx->reclaimer->callbacks.clean_up;
+	rope_ptr_t iter;
+	void *ptr;
+
+	for( int cont = rope_iterator_create( bag, &iter );
+		cont;
+		cont = rope_iterator_next( &iter )
+	)
+		clean_up( rope_owner_iterator_deref( &iter ) );
+
+	for( int cont = rope_iterator_create( bag, &iter );
+		cont;
+		cont = rope_iterator_next( &iter )
+	) {
+		ptr = rope_owner_iterator_deref( &iter );
+
+		if( rope_owner_delete( bag, &iter ) )
+			_object_dispose( ctx, ptr );
+	}
+
+	// bags aren't walked by other threads
+	if( rope_owner_shrink( bag ) )
+		rope_owner_free_retired( bag );
+}
+
+// bag holds objects retired during the epoch it was current in; objects
+// retired in epoch e can't be reached by anybody once global epoch is
+// e + 2; the bag which becomes current in epoch e has been filled in epoch
+// e - 3 so it's always safe to empty it
+static void _ebr_sync( thread_ctx_t *ctx, AO_t epoch ) {
+	if( epoch == ctx->ebr.epoch )
+		return;
+
+	AO_t shifts = epoch - ctx->ebr.epoch;
+	if( shifts > EBR_BAGS_NUMBER )
+		shifts = EBR_BAGS_NUMBER;
+
+	for( AO_t k = 1; k <= shifts; ++k )
+		_ebr_free_bag( ctx,
+			ctx->ebr.bags[ ( ctx->ebr.epoch + k ) % EBR_BAGS_NUMBER ]
+		);
+
+	ctx->ebr.epoch = epoch;
+	ctx->deleted = ctx->ebr.bags[ epoch % EBR_BAGS_NUMBER ];
+}
+
+// global epoch may be advanced only if every thread being in critical
+// section has observed the current one
+static int _ebr_try_advance( thread_ctx_t *own_ctx ) {
+	reclaimer_t *r = own_ctx->reclaimer;
+	AO_t epoch = AO_load( &( r->epoch ) );
+	AO_t local;
+	int is_behind = 0;
+	uint64_t start = _stats_scan_begin();
+
+	_ctx_rcu_mark_as_reader( own_ctx );
+
+	for( thread_ctx_t *ctx = ( thread_ctx_t* ) AO_load(
+			( AO_t* ) &( r->ctx_list.next )
+		);
+		ctx != NULL;
+		ctx = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( ctx->header.next ) )
+	) {
+		local = AO_load( &( ctx->ebr.local ) );
+
+		if( ( local & EBR_ACTIVE ) && ( ( local >> 1 ) != epoch ) ) {
+			is_behind = 1;
+			break;
+		}
+	}
+
+	_ctx_rcu_unmark_as_reader( own_ctx );
+	_stats_scan_end( own_ctx, start );
+
+	if( is_behind )
+		return 0;
+
+	AO_compare_and_swap_full( &( r->epoch ), epoch, epoch + 1 );
+
+	return 1;
+}
+
+void ebr_enter( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+
+	if( ( ctx->ebr.nesting )++ > 0 )
+		return;
+
+	AO_t epoch;
+
+	// thread has to be visible as active in the epoch it has observed;
+	// otherwise global epoch could go two steps ahead unnoticed
+	do {
+		epoch = AO_load( &( ctx->reclaimer->epoch ) );
+		AO_store( &( ctx->ebr.local ), ( epoch << 1 ) | EBR_ACTIVE );
+		AO_nop_full();
+	} while( AO_load( &( ctx->reclaimer->epoch ) ) != epoch );
+
+	_ebr_sync( ctx, epoch );
+}
+
+void ebr_exit( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+	assert( ctx->ebr.nesting > 0 );
+
+	if( --( ctx->ebr.nesting ) > 0 )
+		return;
+
+	// all the reads inside critical section must be completed before
+	// the thread is seen as quiescent
+	AO_nop_full();
+	AO_store( &( ctx->ebr.local ), 0 );
+}
+
+void ebr_retire( thread_ctx_t *ctx, void * const *what, size_t n ) {
+	assert( ctx != NULL );
+
+	_ebr_sync( ctx, AO_load( &( ctx->reclaimer->epoch ) ) );
+
+	for( size_t i = 0; i < n; ++i )
+		_link_mark_as_deleted( what[ i ] );
+
+	rope_owner_put_n( ctx->deleted, what, n );
+
+	reclaim_policy_t *policy = &( ctx->reclaimer->policy );
+	size_t backlog = ctx->deleted->ptrs_number;
+
+	if( ! policy->is_due( ctx, backlog ) )
+		return;
+
+	// failed advance is reported to the policy as attempt freeing nothing
+	AO_t reclaimed = ctx->stats.reclaimed;
+
+	if( _ebr_try_advance( ctx ) )
+		_ebr_sync( ctx, AO_load( &( ctx->reclaimer->epoch ) ) );
+
+	if( policy->scanned != NULL )
+		policy->scanned( ctx, backlog, ctx->stats.reclaimed - reclaimed );
+}
+
+void ebr_collect( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+
+	_ebr_try_advance( ctx );
+	_ebr_sync( ctx, AO_load( &( ctx->reclaimer->epoch ) ) );
+}
+
+// called from reclaim_fini only; nobody can hold references anymore so
+// bags are emptied without waiting for the epoch to advance
+void ebr_ctx_fini( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+	assert( ctx->ebr.nesting == 0 );
+
+	// current bag is emptied and destroyed along with the rest of
+	// the context
+	for( int i = 0; i < EBR_BAGS_NUMBER; ++i )
+		if( ctx->ebr.bags[ i ] != ctx->deleted ) {
+			_ebr_free_bag( ctx, ctx->ebr.bags[ i ] );
+			rope_destroy( ctx->ebr.bags[ i ] );
+		}
+}
@@ -0,0 +1,17 @@
+#ifndef LIBRECLAIM_EBR
+#define LIBRECLAIM_EBR
+
+// epoch-based reclamation engine (RECLAIM_MODE_EPOCHS); not a part of
+// public API
+
+#include <reclaim/reclaim.h>
+
+extern void ebr_ctx_init( thread_ctx_t *ctx );
+// releases engine state of the context; reclaimer must be quiescent
+extern void ebr_ctx_fini( thread_ctx_t *ctx );
+extern void ebr_enter( thread_ctx_t *ctx );
+extern void ebr_exit( thread_ctx_t *ctx );
+extern void ebr_retire( thread_ctx_t *ctx, void * const *what, size_t n );
+extern void ebr_collect( thread_ctx_t *ctx );
+
+#endif
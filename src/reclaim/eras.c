@@ -0,0 +1,265 @@
+#include <reclaim/eras.h>
+#include <reclaim_config.h>
+
+#include <stdlib.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+#include <utils/rope.h>
+#include <reclaim/internal.h>
+
+// number of allocations made by a thread between increments of global era
+#ifndef ERAS_FREQ
+	#define ERAS_FREQ 64
+#endif
+
+// reader publishes interval of eras [ lower, upper ] it could have
+// observed links in since entering critical section; object is safe to
+// free when its lifetime [ birth, retire ] doesn't intersect any of
+// published intervals; lower equal to 0 means that thread is quiescent
+
+void eras_ctx_init( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+
+	ctx->eras.lower = 0;
+	ctx->eras.upper = 0;
+	ctx->eras.nesting = 0;
+	ctx->eras.allocs = 0;
+	ctx->eras.capacity = 0;
+	ctx->eras.intervals = NULL;
+}
+
+void eras_enter( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+
+	if( ( ctx->eras.nesting )++ > 0 )
+		return;
+
+	AO_t era = AO_load( &( ctx->reclaimer->era ) );
+
+	AO_store( &( ctx->eras.upper ), era );
+	AO_store( &( ctx->eras.lower ), era );
+	AO_nop_full();
+}
+
+void eras_exit( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+	assert( ctx->eras.nesting > 0 );
+
+	if( --( ctx->eras.nesting ) > 0 )
+		return;
+
+	AO_nop_full();
+	AO_store( &( ctx->eras.lower ), 0 );
+}
+
+// fence is issued only if global era has changed since last dereference;
+// the interval is published on enter so dereference outside of critical
+// section wouldn't be protected at all
+void *eras_deref_link( thread_ctx_t *ctx, void * volatile *ptr_to_link ) {
+	assert( ctx->eras.nesting > 0 );
+
+	void *ptr;
+	AO_t era;
+
+	for( ;; ) {
+		ptr = ( void* ) AO_load( ( AO_t* ) ptr_to_link );
+		era = AO_load( &( ctx->reclaimer->era ) );
+
+		if( era == ctx->eras.upper )
+			return ptr;
+
+		AO_store( &( ctx->eras.upper ), era );
+		AO_nop_full();
+	}
+}
+
+void eras_stamp_birth( thread_ctx_t *ctx, void *link ) {
+	if( ++( ctx->eras.allocs ) % ERAS_FREQ == 0 )
+		fetch_and_inc( &( ctx->reclaimer->era ) );
+
+	_link_get_eras( link )[ ERA_BIRTH ] = AO_load( &( ctx->reclaimer->era ) );
+}
+
+static int _compare_intervals( const void *a, const void *b ) {
+	AO_t lower_a = ( ( const AO_t* ) a )[ 0 ],
+		lower_b = ( ( const AO_t* ) b )[ 0 ];
+
+	if( lower_a < lower_b )
+		return -1;
+
+	if( lower_a > lower_b )
+		return 1;
+
+	return 0;
+}
+
+inline static void _eras_push_interval( thread_ctx_t *own_ctx,
+	size_t *num,
+	AO_t lower,
+	AO_t upper
+) {
+	if( *num == own_ctx->eras.capacity ) {
+		own_ctx->eras.capacity = ( own_ctx->eras.capacity == 0 ) ?
+			POINTERS_NUMBER :
+			own_ctx->eras.capacity * 2;
+		own_ctx->eras.intervals = realloc( own_ctx->eras.intervals,
+			sizeof( AO_t ) * 2 * own_ctx->eras.capacity
+		);
+	}
+
+	own_ctx->eras.intervals[ *num * 2 ] = lower;
+	own_ctx->eras.intervals[ *num * 2 + 1 ] = upper;
+	++( *num );
+}
+
+// collects published intervals and merges overlapping ones; returns
+// number of disjoint intervals sorted by lower bound
+static size_t _eras_snapshot( thread_ctx_t *own_ctx ) {
+	AO_t lower, upper;
+	size_t num = 0;
+
+	_ctx_rcu_mark_as_reader( own_ctx );
+
+	for( thread_ctx_t *ctx = ( thread_ctx_t* ) AO_load(
+			( AO_t* ) &( own_ctx->reclaimer->ctx_list.next )
+		);
+		ctx != NULL;
+		ctx = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( ctx->header.next ) )
+	) {
+		lower = AO_load( &( ctx->eras.lower ) );
+		upper = AO_load( &( ctx->eras.upper ) );
+
+		// upper bound is updated without touching lower one so it might
+		// be stale here; it's never less than lower of the same section
+		if( lower != 0 )
+			_eras_push_interval( own_ctx,
+				&num,
+				lower,
+				( upper < lower ) ? lower : upper
+			);
+	}
+
+	_ctx_rcu_unmark_as_reader( own_ctx );
+
+	// array is allocated on the first push so it's NULL while nobody
+	// has been inside of critical section
+	AO_t *intervals = own_ctx->eras.intervals;
+	if( num > 0 )
+		qsort( intervals, num, sizeof( AO_t ) * 2, _compare_intervals );
+
+	size_t merged = 0;
+	for( size_t i = 0; i < num; ++i )
+		if( ( merged > 0 ) &&
+			( intervals[ i * 2 ] <= intervals[ ( merged - 1 ) * 2 + 1 ] )
+		) {
+			if( intervals[ i * 2 + 1 ] > intervals[ ( merged - 1 ) * 2 + 1 ] )
+				intervals[ ( merged - 1 ) * 2 + 1 ] = intervals[ i * 2 + 1 ];
+		} else {
+			intervals[ merged * 2 ] = intervals[ i * 2 ];
+			intervals[ merged * 2 + 1 ] = intervals[ i * 2 + 1 ];
+			++merged;
+		}
+
+	return merged;
+}
+
+inline static int _eras_is_reserved( const AO_t *intervals,
+	size_t num,
+	AO_t birth,
+	AO_t retire
+) {
+	// the last interval starting not later than object retirement is
+	// the only candidate for intersection
+	size_t lo = 0, hi = num;
+
+	while( lo < hi ) {
+		size_t mid = ( lo + hi ) / 2;
+
+		if( intervals[ mid * 2 ] <= retire )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return ( lo > 0 ) && ( intervals[ ( lo - 1 ) * 2 + 1 ] >= birth );
+}
+
+static void _eras_scan( thread_ctx_t *own_ctx ) {
+	void ( *clean_up )( void *ptr ) = own_ctx->reclaimer->callbacks.clean_up;
+	uint64_t start = _stats_scan_begin();
+
+	// era has to be stamped on retired objects before intervals are read
+	AO_nop_full();
+
+	size_t num = _eras_snapshot( own_ctx );
+	rope_ptr_t iter;
+	AO_t *eras;
+	void *ptr;
+
+	for( int cont = rope_iterator_create( own_ctx->deleted, &iter );
+		cont;
+		cont = rope_iterator_next( &iter )
+	) {
+		ptr = rope_owner_iterator_deref( &iter );
+		eras = _link_get_eras( ptr );
+
+		if( ! _eras_is_reserved( own_ctx->eras.intervals,
+				num,
+				eras[ ERA_BIRTH ],
+				eras[ ERA_RETIRE ]
+			) &&
+			rope_owner_delete( own_ctx->deleted, &iter )
+		) {
+			clean_up( ptr );
+			_object_dispose( own_ctx, ptr );
+		}
+	}
+
+	// deletion list isn't walked by other threads in this mode
+	if( rope_owner_shrink( own_ctx->deleted ) )
+		rope_owner_free_retired( own_ctx->deleted );
+
+	_stats_scan_end( own_ctx, start );
+}
+
+void eras_retire( thread_ctx_t *ctx, void * const *what, size_t n ) {
+	assert( ctx != NULL );
+
+	AO_t era = AO_load( &( ctx->reclaimer->era ) );
+
+	for( size_t i = 0; i < n; ++i ) {
+		_link_get_eras( what[ i ] )[ ERA_RETIRE ] = era;
+		_link_mark_as_deleted( what[ i ] );
+	}
+
+	rope_owner_put_n( ctx->deleted, what, n );
+
+	reclaim_policy_t *policy = &( ctx->reclaimer->policy );
+	size_t backlog = ctx->deleted->ptrs_number;
+
+	if( ! policy->is_due( ctx, backlog ) )
+		return;
+
+	AO_t reclaimed = ctx->stats.reclaimed;
+
+	_eras_scan( ctx );
+
+	if( policy->scanned != NULL )
+		policy->scanned( ctx, backlog, ctx->stats.reclaimed - reclaimed );
+}
+
+void eras_collect( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+
+	_eras_scan( ctx );
+}
+
+// called from reclaim_fini only; objects left in the deletion list are
+// disposed along with the rest of the context
+void eras_ctx_fini( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+	assert( ctx->eras.nesting == 0 );
+
+	free( ctx->eras.intervals );
+}
@@ -0,0 +1,19 @@
+#ifndef LIBRECLAIM_ERAS
+#define LIBRECLAIM_ERAS
+
+// interval-based reclamation engine (RECLAIM_MODE_ERAS); not a part of
+// public API
+
+#include <reclaim/reclaim.h>
+
+extern void eras_ctx_init( thread_ctx_t *ctx );
+// releases engine state of the context; reclaimer must be quiescent
+extern void eras_ctx_fini( thread_ctx_t *ctx );
+extern void eras_enter( thread_ctx_t *ctx );
+extern void eras_exit( thread_ctx_t *ctx );
+extern void *eras_deref_link( thread_ctx_t *ctx, void * volatile *ptr_to_link );
+extern void eras_stamp_birth( thread_ctx_t *ctx, void *link );
+extern void eras_retire( thread_ctx_t *ctx, void * const *what, size_t n );
+extern void eras_collect( thread_ctx_t *ctx );
+
+#endif
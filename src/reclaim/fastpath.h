@@ -0,0 +1,190 @@
+#ifndef LIBRECLAIM_FASTPATH
+#define LIBRECLAIM_FASTPATH
+
+// inline fast paths of context lookup and hazard slots; included by
+// reclaim.h, don't include it directly; only page growth and the first
+// lookup of the context by the thread leave the caller
+
+#include <stddef.h>
+#include <stdint.h>
+#include <strings.h>
+#include <atomic_ops.h>
+
+// bit is set in summary of hazard page if corresponding word of occupied
+// mask has a free slot
+#define HAZARD_SUMMARY_FULL \
+	( ( ~ ( AO_t ) 0 ) >> ( POINTERS_NUMBER - HAZARD_PAGE_WORDS ) )
+
+// context of the calling thread for the reclaimer it used last; ids are
+// never reused so context of finalized reclaimer isn't returned for
+// another one allocated at the same address; id 0 means there is none
+typedef struct {
+	AO_t id;
+	thread_ctx_t *ctx;
+} reclaim_tls_t;
+
+extern __thread reclaim_tls_t reclaim_tls;
+
+// out-of-line halves of the functions below
+extern thread_ctx_t *reclaim_get_context_slow( reclaimer_t *r );
+extern void reclaim_hazard_add_page( thread_ctx_t *ctx );
+
+inline static thread_ctx_t *reclaim_get_context( reclaimer_t *r ) {
+	if( reclaim_tls.id == r->id )
+		return reclaim_tls.ctx;
+
+	return reclaim_get_context_slow( r );
+}
+
+// fence on the reader side of hazard publication; it's only a compiler
+// barrier in asymmetric mode since scanner forces memory barrier on
+// every thread
+inline static void _hazard_light_fence( reclaimer_t *r ) {
+	if( r->flags & RECLAIM_ASYMMETRIC_FENCE )
+		AO_compiler_barrier();
+	else
+		AO_nop_full();
+}
+
+inline static size_t _hazard_next_free_page( thread_ctx_t *ctx, size_t idx ) {
+	while( ( idx < ctx->hazard.pages_num ) &&
+		( ctx->hazard.summaries[ idx ] == 0 )
+	)
+		++idx;
+
+	return idx;
+}
+
+// only owner thread changes bitmaps; scanners read words of occupied
+// mask to skip free slots hence they are stored atomically
+inline static reclaim_hazard_t reclaim_hazard_acquire( thread_ctx_t *ctx ) {
+	size_t idx = ctx->hazard.free_idx;
+
+	if( idx == ctx->hazard.pages_num )
+		reclaim_hazard_add_page( ctx );
+
+	hazard_page_t *page = ctx->hazard.pages[ idx ];
+	int w = ffsl( ctx->hazard.summaries[ idx ] ) - 1;
+	int b = ffsl( ~ page->occupied[ w ] ) - 1;
+	AO_t word = page->occupied[ w ] | ( ( AO_t ) 1 << b );
+
+	AO_store( &( page->occupied[ w ] ), word );
+
+	if( word == ~ ( AO_t ) 0 ) {
+		ctx->hazard.summaries[ idx ] &= ~ ( ( AO_t ) 1 << w );
+
+		if( ctx->hazard.summaries[ idx ] == 0 )
+			ctx->hazard.free_idx = _hazard_next_free_page( ctx, idx + 1 );
+	}
+
+	if( ++ctx->hazard.used > ctx->stats.hazards_peak )
+		AO_store( &( ctx->stats.hazards_peak ), ctx->hazard.used );
+
+	return idx * HAZARD_PAGE_SLOTS + w * POINTERS_NUMBER + b;
+}
+
+inline static void **reclaim_hazard_slot( thread_ctx_t *ctx,
+	reclaim_hazard_t h
+) {
+	return &( ctx->hazard.pages[ h / HAZARD_PAGE_SLOTS ]->ptrs[
+		h % HAZARD_PAGE_SLOTS
+	] );
+}
+
+inline static void _hazard_release_at( thread_ctx_t *ctx,
+	size_t idx,
+	size_t slot
+) {
+	hazard_page_t *page = ctx->hazard.pages[ idx ];
+	size_t w = slot / POINTERS_NUMBER;
+
+	AO_store( ( AO_t* ) &( page->ptrs[ slot ] ), ( AO_t ) NULL );
+	AO_store( &( page->occupied[ w ] ),
+		page->occupied[ w ] & ( ~ ( ( AO_t ) 1 << ( slot % POINTERS_NUMBER ) ) )
+	);
+	ctx->hazard.summaries[ idx ] |= ( AO_t ) 1 << w;
+	--ctx->hazard.used;
+
+	if( idx < ctx->hazard.free_idx )
+		ctx->hazard.free_idx = idx;
+}
+
+// unlike reclaim_release_link it doesn't search for the slot holding
+// the link; RECLAIM_NO_HAZARD is ignored
+inline static void reclaim_hazard_release( thread_ctx_t *ctx,
+	reclaim_hazard_t h
+) {
+	if( h == RECLAIM_NO_HAZARD )
+		return;
+
+	_hazard_release_at( ctx, h / HAZARD_PAGE_SLOTS, h % HAZARD_PAGE_SLOTS );
+	_hazard_light_fence( ctx->reclaimer );
+}
+
+// releases slots taken by reclaim_deref_links with one fence for all of
+// them; RECLAIM_NO_HAZARD handles are ignored
+inline static void reclaim_hazard_release_n( thread_ctx_t *ctx,
+	const reclaim_hazard_t *handles,
+	size_t n
+) {
+	int is_released = 0;
+
+	for( size_t i = 0; i < n; ++i )
+		if( handles[ i ] != RECLAIM_NO_HAZARD ) {
+			_hazard_release_at( ctx,
+				handles[ i ] / HAZARD_PAGE_SLOTS,
+				handles[ i ] % HAZARD_PAGE_SLOTS
+			);
+			is_released = 1;
+		}
+
+	if( is_released )
+		_hazard_light_fence( ctx->reclaimer );
+}
+
+// protects the link like reclaim_deref_link; if *h is RECLAIM_NO_HAZARD
+// then a slot is acquired and its handle is stored into *h, otherwise
+// the slot is reused and whatever it protected before isn't protected
+// anymore; h is left untouched in modes other than hazard pointers
+inline static void *reclaim_protect_link( thread_ctx_t *ctx,
+	void * volatile *ptr_to_link,
+	reclaim_hazard_t *h
+) {
+	void *ptr;
+
+	// critical section protects everything reachable in epoch-based mode
+	if( ( ctx->reclaimer->flags & RECLAIM_MODE_MASK ) == RECLAIM_MODE_EPOCHS )
+		return ( void* ) AO_load( ( AO_t* ) ptr_to_link );
+
+	if( ( ctx->reclaimer->flags & RECLAIM_MODE_MASK ) == RECLAIM_MODE_ERAS ) {
+		reclaim_deref_links( ctx, &ptr_to_link, &ptr, NULL, 1 );
+		return ptr;
+	}
+
+	if( *h == RECLAIM_NO_HAZARD )
+		*h = reclaim_hazard_acquire( ctx );
+
+	void **slot = reclaim_hazard_slot( ctx, *h );
+
+	do {
+		ptr = ( void* ) AO_load( ( AO_t* ) ptr_to_link );
+		AO_store( ( AO_t* ) slot, ( AO_t ) ptr );
+		_hazard_light_fence( ctx->reclaimer );
+	} while (
+		( void* ) AO_load( ( AO_t* ) ptr_to_link ) != ptr
+	);
+
+	return ptr;
+}
+
+// link stays protected until reclaim_release_link finds it among the
+// slots of the context
+inline static void *reclaim_deref_link( thread_ctx_t *ctx,
+	void * volatile *ptr_to_link
+) {
+	reclaim_hazard_t h = RECLAIM_NO_HAZARD;
+
+	return reclaim_protect_link( ctx, ptr_to_link, &h );
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef LIBRECLAIM_INTERNAL
+#define LIBRECLAIM_INTERNAL
+
+// helpers shared by reclamation engines; not a part of public API
+
+#include <time.h>
+#include <stdint.h>
+#include <atomic_ops.h>
+
+#include <reclaim/reclaim.h>
+#include <utils/slab.h>
+#include <utils/faa.h>
+#include <utils/futex.h>
+
+#define LINK_IS_DELETED ( 1ul << ( sizeof( AO_t ) * 8 - 1 ) )
+#define LINK_IS_TRACED ( LINK_IS_DELETED >> 1 )
+// object has been terminated while claimed and is counted in
+// stats.terminated till it's freed
+#define LINK_IS_TERMINATED ( LINK_IS_TRACED >> 1 )
+
+#define RECLAIM_MODE( r ) ( ( r )->flags & RECLAIM_MODE_MASK )
+
+inline static AO_t *_link_get_ancillary( void *link ) {
+	return ( AO_t*  ) ( ( ( char* ) link ) - sizeof( AO_t ) );
+}
+
+// RECLAIM_MODE_ERAS keeps birth and retire eras of the object in
+// the ancillary block right before the ancillary word
+#define ERA_BIRTH 0
+#define ERA_RETIRE 1
+#define ERAS_ANCILLARY_SIZE ( sizeof( AO_t ) * 3 )
+
+inline static AO_t *_link_get_eras( void *link ) {
+	return ( AO_t*  ) ( ( ( char* ) link ) - ERAS_ANCILLARY_SIZE );
+}
+
+inline static void _link_mark_as_deleted( void *what ) {
+	AO_t *auxrec = _link_get_ancillary( what );
+	AO_t aux;
+
+	do {
+		aux = AO_load( auxrec );
+	} while (
+		! AO_compare_and_swap_full( auxrec,
+			aux,
+			( aux | LINK_IS_DELETED ) & ( ~LINK_IS_TRACED )
+		)
+	);
+}
+
+// only the owner changes its counter hence plain increment is enough;
+// fence orders the counter against loads of the list; only the outermost
+// section changes the counter
+inline static void _ctx_rcu_mark_as_reader( thread_ctx_t *ctx ) {
+	if( ( ctx->list_nesting )++ > 0 )
+		return;
+
+	AO_store( &( ctx->list_reader_ctr ), ctx->list_reader_ctr + 1 );
+	AO_nop_full();
+}
+
+// counter and waiters flag are paired the same way on both sides so
+// either writer observes the counter changed or reader observes the flag
+inline static void _ctx_rcu_unmark_as_reader( thread_ctx_t *ctx ) {
+	if( --( ctx->list_nesting ) > 0 )
+		return;
+
+	AO_nop_full();
+	AO_store( &( ctx->list_reader_ctr ), ctx->list_reader_ctr + 1 );
+	AO_nop_full();
+
+	if( AO_int_load( &( ctx->list_waiters ) ) ) {
+		AO_int_store( &( ctx->list_waiters ), 0 );
+		futex_wake_all( &( ctx->list_waiters ) );
+	}
+}
+
+// statistics counters are changed by the owner only so there is no need
+// in atomic read-modify-write; stores are atomic for concurrent readers
+inline static void _stats_add( AO_t *counter, AO_t n ) {
+	AO_store( counter, *counter + n );
+}
+
+inline static void _stats_max( AO_t *peak, AO_t value ) {
+	if( value > *peak )
+		AO_store( peak, value );
+}
+
+inline static uint64_t _stats_scan_begin( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( uint64_t ) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+inline static void _stats_scan_end( thread_ctx_t *ctx, uint64_t start ) {
+	// approximately microseconds
+	uint64_t us = ( _stats_scan_begin() - start ) >> 10;
+	int bucket = ( us > 1 ) ? ( 63 - __builtin_clzll( us ) ) : 0;
+
+	if( bucket >= RECLAIM_STATS_BUCKETS )
+		bucket = RECLAIM_STATS_BUCKETS - 1;
+
+	_stats_add( &( ctx->stats.scans ), 1 );
+	_stats_add( &( ctx->stats.scan_hist[ bucket ] ), 1 );
+}
+
+// bytes of accounting changes kept by the thread before they are
+// published in the budget of the reclaimer
+#ifndef RECLAIM_BUDGET_BATCH
+	#define RECLAIM_BUDGET_BATCH ( 1 << 14 )
+#endif
+
+#define INSTANCE_BYTES( r ) ( ( r )->instance.size + ( r )->instance.align )
+
+// counter is changed with wrapping unsigned arithmetic; it goes below
+// zero for a while if reclamation is published before retirement
+inline static int _budget_is_exceeded( reclaimer_t *r ) {
+	AO_t limit = AO_load( &( r->budget.limit ) );
+
+	return ( limit > 0 ) &&
+		( ( long ) AO_load( &( r->budget.unreclaimed ) ) > ( long ) limit );
+}
+
+inline static void _budget_publish( thread_ctx_t *ctx ) {
+	reclaimer_t *r = ctx->reclaimer;
+	long pending = ctx->budget.pending;
+
+	if( pending == 0 )
+		return;
+
+	ctx->budget.pending = 0;
+	AO_fetch_and_add_full( &( r->budget.unreclaimed ), ( AO_t ) pending );
+
+	if( ( pending < 0 ) &&
+		AO_int_load( &( r->budget.waiters ) ) &&
+		! _budget_is_exceeded( r )
+	) {
+		AO_int_store( &( r->budget.waiters ), 0 );
+		futex_wake_all( &( r->budget.waiters ) );
+	}
+}
+
+inline static void _budget_account( thread_ctx_t *ctx, long bytes ) {
+	ctx->budget.pending += bytes;
+
+	if( ( ctx->budget.pending >= RECLAIM_BUDGET_BATCH ) ||
+		( ctx->budget.pending <= -RECLAIM_BUDGET_BATCH )
+	)
+		_budget_publish( ctx );
+}
+
+// object must be unreachable for every thread at this point
+inline static void _object_dispose( thread_ctx_t *ctx, void *ptr ) {
+	if( AO_load( _link_get_ancillary( ptr ) ) & LINK_IS_TERMINATED )
+		_stats_add( &( ctx->stats.terminated ), ( AO_t ) -1 );
+
+	_stats_add( &( ctx->stats.reclaimed ), 1 );
+	_budget_account( ctx, - ( long ) INSTANCE_BYTES( ctx->reclaimer ) );
+	ctx->reclaimer->callbacks.terminate( ptr, 0 );
+
+	// pools differ in node only so any of them locates the chunk
+	void *obj = ( ( char* ) ptr ) - ctx->reclaimer->instance.align;
+	int node = slab_node_of( &( ctx->reclaimer->pools[ 0 ] ), obj );
+
+	slab_free( &( ctx->reclaimer->pools[ node ] ),
+		&( ctx->caches[ node ] ),
+		obj
+	);
+}
+
+#endif
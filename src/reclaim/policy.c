@@ -0,0 +1,139 @@
+#include <reclaim/reclaim.h>
+#include <reclaim_config.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <atomic_ops.h>
+
+#include <reclaim/internal.h>
+
+// adaptive threshold is never raised above this number of objects
+#ifndef RECLAIM_ADAPTIVE_MAX
+	#define RECLAIM_ADAPTIVE_MAX ( POINTERS_NUMBER << 12 )
+#endif
+
+// the bound reclaim_free used before policies; every thread can hold up
+// to POINTERS_NUMBER hazards so scan with longer list frees something
+inline static size_t _policy_default_bound( thread_ctx_t *ctx ) {
+	size_t bound = AO_load( &( ctx->reclaimer->threads_num ) ) *
+		POINTERS_NUMBER;
+
+	return ( bound > 0 ) ? bound : POINTERS_NUMBER;
+}
+
+static int _count_is_due( thread_ctx_t *ctx, size_t backlog ) {
+	size_t param = ctx->reclaimer->policy.param;
+
+	return backlog >= ( ( param > 0 ) ? param : _policy_default_bound( ctx ) );
+}
+
+// all the instances have the same size
+static int _bytes_is_due( thread_ctx_t *ctx, size_t backlog ) {
+	reclaimer_t *r = ctx->reclaimer;
+
+	return backlog * ( r->instance.size + r->instance.align ) >=
+		r->policy.param;
+}
+
+static int _time_is_due( thread_ctx_t *ctx, size_t backlog ) {
+	if( backlog == 0 )
+		return 0;
+
+	uint64_t now = _stats_scan_begin();
+
+	// the first retirement starts the period
+	if( ctx->trigger.last_scan == 0 )
+		ctx->trigger.last_scan = now;
+
+	return ( now - ctx->trigger.last_scan ) >=
+		( uint64_t ) ctx->reclaimer->policy.param * 1000;
+}
+
+static void _time_scanned( thread_ctx_t *ctx,
+	size_t backlog,
+	size_t reclaimed
+) {
+	( void ) backlog;
+	( void ) reclaimed;
+
+	ctx->trigger.last_scan = _stats_scan_begin();
+}
+
+static int _adaptive_is_due( thread_ctx_t *ctx, size_t backlog ) {
+	if( ctx->trigger.threshold == 0 ) {
+		size_t param = ctx->reclaimer->policy.param;
+
+		ctx->trigger.threshold = ( param > 0 ) ?
+			param :
+			_policy_default_bound( ctx );
+	}
+
+	return backlog >= ctx->trigger.threshold;
+}
+
+// threshold is doubled after scan which freed less than a quarter of
+// the list and halved after scan which freed more than three quarters;
+// it's kept above hazards observed by the last scan since they can't be
+// reclaimed anyway
+static void _adaptive_scanned( thread_ctx_t *ctx,
+	size_t backlog,
+	size_t reclaimed
+) {
+	size_t threshold = ctx->trigger.threshold;
+	size_t floor = 2 * ctx->scan.hazards_num;
+
+	if( floor < POINTERS_NUMBER )
+		floor = POINTERS_NUMBER;
+
+	if( reclaimed * 4 < backlog )
+		threshold *= 2;
+	else if( reclaimed * 4 > backlog * 3 )
+		threshold /= 2;
+
+	if( threshold > RECLAIM_ADAPTIVE_MAX )
+		threshold = RECLAIM_ADAPTIVE_MAX;
+
+	ctx->trigger.threshold = ( threshold < floor ) ? floor : threshold;
+}
+
+reclaim_policy_t reclaim_policy_count( size_t objects ) {
+	return ( reclaim_policy_t ) {
+		.is_due = _count_is_due,
+		.scanned = NULL,
+		.param = objects
+	};
+}
+
+reclaim_policy_t reclaim_policy_bytes( size_t bytes ) {
+	assert( bytes > 0 );
+
+	return ( reclaim_policy_t ) {
+		.is_due = _bytes_is_due,
+		.scanned = NULL,
+		.param = bytes
+	};
+}
+
+reclaim_policy_t reclaim_policy_time( size_t us ) {
+	return ( reclaim_policy_t ) {
+		.is_due = _time_is_due,
+		.scanned = _time_scanned,
+		.param = us
+	};
+}
+
+reclaim_policy_t reclaim_policy_adaptive( size_t objects ) {
+	return ( reclaim_policy_t ) {
+		.is_due = _adaptive_is_due,
+		.scanned = _adaptive_scanned,
+		.param = objects
+	};
+}
+
+void reclaim_set_policy( reclaimer_t *r, reclaim_policy_t policy ) {
+	assert( r != NULL );
+	assert( policy.is_due != NULL );
+
+	r->policy = policy;
+	AO_nop_full();
+}
@@ -3,145 +3,481 @@
 
 #include <utils/rope.h>
 #include <utils/faa.h>
-
-#define EMPTY_MAP ( ~( 0ul ) )
-
-static struct timespec _spin_timeout = {
-	.tv_sec = 0,
-	.tv_nsec = 400
-};
+#include <utils/ptrset.h>
+#include <utils/slab.h>
+#include <utils/membarrier.h>
+
+#include <reclaim/internal.h>
+#include <reclaim/ebr.h>
+#include <reclaim/eras.h>
+#include <reclaim/workers.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdalign.h>
+
+// helpers used before their definitions
+static void _destroy_ctx( void *ctx );
+inline static thread_ctx_t *_ctx_create( reclaimer_t *r, int node );
+inline static void _ctx_put_into_list( thread_ctx_t *ctx );
+static void _hazard_release_all( thread_ctx_t *ctx );
+inline static void _link_inc_ref_cnt( void *link );
+inline static void _link_dec_ref_cnt( void *link );
+static void _budget_help( thread_ctx_t *ctx );
+static void _scan( thread_ctx_t *own_ctx );
+static void _clean_all( thread_ctx_t *own_ctx );
+static void _clean_local( thread_ctx_t *ctx );
+
+__thread reclaim_tls_t reclaim_tls;
+
+static AO_t _reclaimers_num = 0;
 
 reclaimer_t *reclaim_init(
 	void ( *terminate )( void *ptr, int is_concurrent ),
 	void ( *clean_up )( void *ptr ),
 	size_t inst_size,
-	size_t inst_align
+	size_t inst_align,
+	int flags
 ) {
 	assert( inst_size > 0 );
-	assert( inst_offset > 0 );
+	assert( inst_align > 0 );
 	
 	reclaimer_t * r = malloc( sizeof( reclaimer_t ) );
+
+	// asymmetric fences fall back to the symmetric ones if kernel can't
+	// provide process-wide barrier
+	if( ( flags & RECLAIM_ASYMMETRIC_FENCE ) && ! membarrier_register() )
+		flags &= ~ RECLAIM_ASYMMETRIC_FENCE;
+
+	// retire lists of epochs and eras aren't scanned against hazards
+	if( ( flags & RECLAIM_MODE_MASK ) != RECLAIM_MODE_HAZARD_POINTERS )
+		flags &= ~ RECLAIM_WORK_STEALING;
+	r->flags = flags;
+	r->id = AO_fetch_and_add1( &_reclaimers_num ) + 1;
+
 	pthread_key_create( &( r->thread_ctx ), &_destroy_ctx );
 	pthread_mutex_init( &( r->write_guard ), NULL );
-	r->list_reader_tag = 0;
 	r->callbacks.clean_up = clean_up;
 	r->callbacks.terminate = terminate;
+	r->policy = reclaim_policy_count( 0 );
+	r->budget.limit = 0;
+	r->budget.unreclaimed = 0;
+	r->budget.waiters = 0;
 	r->instance.size = inst_size;
 
 	if( inst_align % alignof( void* ) )
 		inst_align = ( inst_align / alignof( void* ) + 1 ) * alignof( void* );
+
+	// eras are stored in ancillary block along with ancillary word
+	if( ( flags & RECLAIM_MODE_MASK ) == RECLAIM_MODE_ERAS )
+		while( inst_align < ERAS_ANCILLARY_SIZE )
+			inst_align <<= 1;
 	r->instance.align = inst_align;
 
-	r->writers_num = 0;
+	r->nodes_num = numa_nodes_num();
+	r->pools = malloc( sizeof( slab_t ) * r->nodes_num );
+	for( size_t node = 0; node < r->nodes_num; ++node )
+		slab_init( &( r->pools[ node ] ),
+			inst_size + inst_align,
+			inst_align,
+			node
+		);
+
 	r->ctx_list.next = NULL;
+	r->parked = calloc( r->nodes_num, sizeof( thread_ctx_t* ) );
 	r->threads_num = 0;
+	r->orphans_num = 0;
+	registry_init( &( r->hazards ) );
+	r->epoch = 0;
+	// era 0 is reserved for quiescent threads
+	r->era = 1;
+	r->workers.num = 0;
+	r->workers.array = NULL;
+	r->workers.is_running = 0;
 
 	AO_nop_full();
 
 	return r;
 }
 
+// contexts are never removed from ctx_list before reclaim_fini; context of
+// finished thread is parked there and handed over to the next thread
+// calling reclaim_get_context; objects it wasn't able to reclaim are
+// adopted by the threads which are still running
+#define CTX_ACTIVE 0
+#define CTX_PARKED 1
+// parked with objects left in deletion list
+#define CTX_ORPHAN 2
+// orphan which is being adopted
+#define CTX_ADOPTING 3
+
+static void _destroy_ctx( void *ctx ) {
+	reclaim_local_fini( ctx );
+}
+
+// owner walks through its deletion list with all the chunks claimed if
+// they can be stolen; rope is rope of ctx or of the orphan it adopts
+inline static void _rope_claim( thread_ctx_t *ctx, rope_t *rope ) {
+	if( ctx->reclaimer->flags & RECLAIM_WORK_STEALING )
+		rope_owner_claim_all( rope );
+}
+
+inline static void _rope_unclaim( thread_ctx_t *ctx, rope_t *rope ) {
+	if( ctx->reclaimer->flags & RECLAIM_WORK_STEALING )
+		rope_owner_unclaim_all( rope );
+}
+
+inline static void _ctx_flush_caches( thread_ctx_t *ctx ) {
+	for( size_t node = 0; node < ctx->reclaimer->nodes_num; ++node )
+		slab_cache_flush( &( ctx->reclaimer->pools[ node ] ),
+			&( ctx->caches[ node ] )
+		);
+}
+
+inline static size_t _ctx_backlog( thread_ctx_t *ctx ) {
+	if( RECLAIM_MODE( ctx->reclaimer ) != RECLAIM_MODE_EPOCHS )
+		return ctx->deleted->ptrs_number;
+
+	size_t backlog = 0;
+	for( size_t i = 0;
+		i < sizeof( ctx->ebr.bags ) / sizeof( ctx->ebr.bags[ 0 ] );
+		++i
+	)
+		backlog += ctx->ebr.bags[ i ]->ptrs_number;
+
+	return backlog;
+}
+
+// never waits for other threads; the only attempt of reclamation is made
+// and the rest is left for adoption
 void reclaim_local_fini( thread_ctx_t *ctx ) {
 	assert( ctx != NULL );
+	assert( AO_load( &( ctx->state ) ) == CTX_ACTIVE );
 
-	_ctx_remove_from_list( ctx );
-	_ctx_rcu_reclaim_ctx( ctx );
-}
+	reclaimer_t *r = ctx->reclaimer;
 
-inline static void _ctx_rcu_reclaim( thread_ctx_t *ctx ) {
-	AO_t my_tag = AO_load( &( ctx->reclaimer->list_reader_tag ) );
-	AO_t thread_tag = 0;
+	if( ctx->offload.worker != NULL )
+		workers_detach( ctx );
 
-	fetch_and_inc( &( ctx->reclaimer->writers_num ) );
-	_ctx_rcu_wait_for_readers( ctx->reclaimer );
-	fetch_and_dec( &( ctx->reclaimer->writers_num ) );
-	_ctx_rcu_wait_for_writers( ctx->reclaimer );
+	_hazard_release_all( ctx );
+	reclaim_collect( ctx );
+	_ctx_flush_caches( ctx );
+	_budget_publish( ctx );
 
-	if( ctx->deleted->ptrs_number > 0 ) {
-		_clean_local( ctx );
+	fetch_and_dec( &( r->threads_num ) );
 
-		do {
-			_scan( ctx );
+	if( _ctx_backlog( ctx ) > 0 ) {
+		fetch_and_inc( &( r->orphans_num ) );
+		AO_store_full( &( ctx->state ), CTX_ORPHAN );
+	} else
+		AO_store_full( &( ctx->state ), CTX_PARKED );
 
-			if( ctx->deleted->ptrs_number > 0 ) {
-				nanosleep( &_spin_timeout, NULL );
-				_scan( ctx );
-			}
+	pthread_mutex_lock( &( r->write_guard ) );
+	ctx->parked_next = r->parked[ ctx->node ];
+	r->parked[ ctx->node ] = ctx;
+	pthread_mutex_unlock( &( r->write_guard ) );
 
-			if( ctx->deleted->ptrs_number > 0 )
-				pthread_yield();
-		} while( ctx->deleted->ptrs_number > 0 );
+	pthread_setspecific( r->thread_ctx, NULL );
+
+	if( reclaim_tls.ctx == ctx ) {
+		reclaim_tls.id = 0;
+		reclaim_tls.ctx = NULL;
 	}
+}
+
+// nobody can hold references to objects at this point so leftovers are
+// disposed without scanning
+static void _ctx_destroy( thread_ctx_t *ctx ) {
+	rope_ptr_t iter;
+	void *ptr;
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_EPOCHS )
+		ebr_ctx_fini( ctx );
+	else if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_ERAS )
+		eras_ctx_fini( ctx );
+
+	// tombstones left by helpers are freed
+	_rope_claim( ctx, ctx->deleted );
 
+	for( int cont = rope_iterator_create( ctx->deleted, &iter );
+		cont;
+		cont = rope_iterator_next( &iter )
+	) {
+		ptr = rope_owner_iterator_deref( &iter );
+
+		if( rope_owner_delete( ctx->deleted, &iter ) )
+			_object_dispose( ctx, ptr );
+	}
+
+	_budget_publish( ctx );
 	rope_destroy( ctx->deleted );
+	ptrset_destroy( &( ctx->scan.hazards ) );
+	_ctx_flush_caches( ctx );
+	free( ctx->caches );
+	free( ctx->steal.candidates );
+	free( ctx->hazard.pages );
+	free( ctx->hazard.summaries );
+	numa_free( ctx, sizeof( thread_ctx_t ) );
+}
+
+// spins for a while and then sleeps on the futex of the context until
+// its reader counter moves away from ctr
+static void _ctx_rcu_wait_for_reader( thread_ctx_t *ctx, AO_t ctr ) {
+	for( int i = 0; i < FUTEX_SPIN_ITERATIONS; ++i ) {
+		if( AO_load( &( ctx->list_reader_ctr ) ) != ctr )
+			return;
+
+		cpu_relax();
+	}
+
+	for( ;; ) {
+		AO_int_store( &( ctx->list_waiters ), 1 );
+		AO_nop_full();
+
+		if( AO_load( &( ctx->list_reader_ctr ) ) != ctr )
+			return;
 
-	free( ctx );
+		futex_wait( &( ctx->list_waiters ), 1 );
+	}
 }
 
-inline static void _ctx_rcu_wait_for_readers( reclaimer_t *r ) {
+// waits for grace period: every reader which might have seen retired
+// data leaves its read-side section; the list can't change while
+// the mutex is held so it's walked without RCU tricks; readers never take
+// the mutex hence there is no deadlock
+static void _ctx_rcu_synchronize( reclaimer_t *r ) {
+	AO_t ctr;
+
+	AO_nop_full();
+	pthread_mutex_lock( &( r->write_guard ) );
+
 	for( thread_ctx_t *ctx = r->ctx_list.next;
 		ctx != NULL;
-		ctx = AO_load( &( ctx->next ) )
-	)
-		while(
-			AO_load( &( ctx->is_list_reader ) ) &&
-			( AO_load( &( ctx->list_reader_tag ) ) < my_tag )
-		) {
-			nanosleep( &_spin_timeout, NULL );
+		ctx = ctx->header.next
+	) {
+		ctr = AO_load( &( ctx->list_reader_ctr ) );
 
-			if(
-				AO_load( &( ctx->is_list_reader ) ) &&
-				( AO_load( &( ctx->list_reader_tag ) ) < my_tag )
-			)
-				pthread_yield();
-		};
+		if( ctr & 1 )
+			_ctx_rcu_wait_for_reader( ctx, ctr );
+	}
+
+	pthread_mutex_unlock( &( r->write_guard ) );
+	AO_nop_full();
 }
 
-inline static void _ctx_rcu_wait_for_writers( reclaimer_t *r ) {
-	while ( AO_load( &( r->writers_num ) ) > 0 ) {
-		nanosleep( &_spin_timeout, NULL );
+// frees memory which ctx_list readers might still be walking through:
+// chunks detached from the deletion list of ctx and directories replaced
+// by the hazard registry; nothing is done inside of read-side section
+// since the grace period would wait for the thread itself
+static void _ctx_free_deferred( thread_ctx_t *ctx ) {
+	reclaimer_t *r = ctx->reclaimer;
 
-		if( AO_load( &( r->writers_num ) ) > 0 )
-			pthread_yield();
-	}
+	if( ctx->list_nesting > 0 )
+		return;
+
+	if( ( ctx->deleted->retired == NULL ) &&
+		! registry_has_retired( &( r->hazards ) )
+	)
+		return;
+
+	hazard_dir_t *dirs = registry_detach_retired( &( r->hazards ) );
+
+	_ctx_rcu_synchronize( r );
+	rope_owner_free_retired( ctx->deleted );
+	registry_free_dirs( dirs );
 }
 
 void reclaim_fini( reclaimer_t *r ) {
 	assert( r != NULL );
-	//TODO: implement something more clever and sync-aware
-	// now, we can steal a chair under logic which
-	// is working with it currently
-	// Moreover, implement thread_ctx purging logic
-	
+	// every thread must have finished working with the reclaimer
+
+	if( reclaim_tls.id == r->id ) {
+		reclaim_tls.id = 0;
+		reclaim_tls.ctx = NULL;
+	}
+
+	if( r->workers.num > 0 )
+		reclaim_workers_stop( r );
+
+	for( thread_ctx_t *ctx = r->ctx_list.next, *next;
+		ctx != NULL;
+		ctx = next
+	) {
+		next = ctx->header.next;
+		_ctx_destroy( ctx );
+	}
+
+	// caches of all the contexts, parked or not, are flushed by now so
+	// pools own every magazine
+
 	pthread_mutex_destroy( &( r->write_guard ) );
 	pthread_key_delete( r->thread_ctx );
+	registry_destroy( &( r->hazards ) );
+
+	for( size_t node = 0; node < r->nodes_num; ++node )
+		slab_destroy( &( r->pools[ node ] ) );
+
+	free( r->pools );
+	free( r->parked );
 	free( r );
 }
 
-thread_ctx_t *reclaim_get_context( reclaimer_t *r ) {
+reclaim_stats_t reclaim_get_stats( reclaimer_t *r ) {
+	assert( r != NULL );
+
+	reclaim_stats_t stats;
+	memset( &stats, 0, sizeof( reclaim_stats_t ) );
+
+	stats.threads_num = AO_load( &( r->threads_num ) );
+
+	// contexts are never freed before reclaim_fini so the list is walked
+	// without read-side section
+	for( thread_ctx_t *ctx = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( r->ctx_list.next ) );
+		ctx != NULL;
+		ctx = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( ctx->header.next ) )
+	) {
+		stats.retired += AO_load( &( ctx->stats.retired ) );
+		stats.reclaimed += AO_load( &( ctx->stats.reclaimed ) );
+		stats.scans += AO_load( &( ctx->stats.scans ) );
+		stats.clean_local += AO_load( &( ctx->stats.clean_local ) );
+		stats.clean_all += AO_load( &( ctx->stats.clean_all ) );
+		stats.terminated += AO_load( &( ctx->stats.terminated ) );
+		stats.stolen += AO_load( &( ctx->stats.stolen ) );
+
+		AO_t peak = AO_load( &( ctx->stats.backlog_peak ) );
+		if( peak > stats.backlog_peak )
+			stats.backlog_peak = peak;
+
+		peak = AO_load( &( ctx->stats.hazards_peak ) );
+		if( peak > stats.hazards_peak )
+			stats.hazards_peak = peak;
+
+		for( int i = 0; i < RECLAIM_STATS_BUCKETS; ++i )
+			stats.scan_hist[ i ] += AO_load( &( ctx->stats.scan_hist[ i ] ) );
+	}
+
+	return stats;
+}
+
+// caller holds write_guard; adopting thread might have taken an orphan
+// meanwhile so state is changed with CAS and orphans being adopted are
+// left in the stack
+static thread_ctx_t *_ctx_take_parked( reclaimer_t *r, int node ) {
+	thread_ctx_t *ctx;
+
+	for( thread_ctx_t **link = &( r->parked[ node ] );
+		( ctx = *link ) != NULL;
+		link = &( ctx->parked_next )
+	) {
+		if( AO_compare_and_swap_full( &( ctx->state ),
+			CTX_PARKED,
+			CTX_ACTIVE
+		) ) {
+			*link = ctx->parked_next;
+			return ctx;
+		}
+
+		// backlog of the orphan is inherited along with the context
+		if( AO_compare_and_swap_full( &( ctx->state ),
+			CTX_ORPHAN,
+			CTX_ACTIVE
+		) ) {
+			fetch_and_dec( &( r->orphans_num ) );
+			*link = ctx->parked_next;
+			return ctx;
+		}
+	}
+
+	return NULL;
+}
+
+// context is taken by a thread of another node; caches were flushed when
+// it was parked so they are empty and only the node changes, and hazard
+// pages go back to the registry to be taken again on the new node
+static void _ctx_rehome( thread_ctx_t *ctx, int node ) {
+	for( size_t idx = 0; idx < ctx->hazard.pages_num; ++idx )
+		registry_page_put( &( ctx->reclaimer->hazards ),
+			ctx->hazard.pages[ idx ],
+			ctx->node
+		);
+
+	ctx->hazard.pages_num = 0;
+	ctx->hazard.free_idx = 0;
+	ctx->node = node;
+}
+
+// thread either has no context yet or uses several reclaimers in turn
+thread_ctx_t *reclaim_get_context_slow( reclaimer_t *r ) {
 	assert( r != NULL );
 	
 	thread_ctx_t *ctx = pthread_getspecific( r->thread_ctx );
 	
+	if( ctx != NULL ) {
+		reclaim_tls.id = r->id;
+		reclaim_tls.ctx = ctx;
+		return ctx;
+	}
+
+	int node = numa_current_node();
+
+	// contexts whose hazard pages and memory are on the same node are
+	// preferred
+	pthread_mutex_lock( &( r->write_guard ) );
+
+	ctx = _ctx_take_parked( r, node );
+
+	for( int i = 0; ( ctx == NULL ) && ( i < ( int ) r->nodes_num ); ++i )
+		if( i != node )
+			ctx = _ctx_take_parked( r, i );
+
+	pthread_mutex_unlock( &( r->write_guard ) );
+
 	if( ctx == NULL ) {
-		thread_ctx_t *ctx = _ctx_create( r );
+		ctx = _ctx_create( r, node );
 		_ctx_put_into_list( ctx );
-	}
+	} else if( ctx->node != node )
+		_ctx_rehome( ctx, node );
+
+	ctx->budget.no_wait = 0;
+	fetch_and_inc( &( r->threads_num ) );
+	pthread_setspecific( r->thread_ctx, ctx );
+	reclaim_tls.id = r->id;
+	reclaim_tls.ctx = ctx;
 
 	return ctx;
 }
 
 #define DELETED_POINTERS_NUMBER ( ( 1 << ( POINTERS_NUMBER_POWER2 + 1 ) ) )
 
-inline static thread_ctx_t *_ctx_create( reclaimer_t *r ) {
+// context is written by the owner on every operation so it's placed on
+// the node of the creating thread; memory comes zeroed
+inline static thread_ctx_t *_ctx_create( reclaimer_t *r, int node ) {
 	assert( r != NULL );
 	
-	thread_ctx_t *ctx = malloc( sizeof( thread_ctx_t ) );
-	memset( ctx, 0, sizeof( thread_ctx_t ) );
-	ctx->hazard.map = EMPTY_MAP;
+	// hazard pages are taken from the registry on the first acquisition
+	thread_ctx_t *ctx = numa_alloc_onnode( sizeof( thread_ctx_t ),
+		CACHE_LINE_SIZE,
+		node
+	);
+
+	// reclaim_get_context has no way to fail
+	if( ctx == NULL )
+		abort();
 
 	ctx->deleted = rope_create();
+	ptrset_init( &( ctx->scan.hazards ) );
 	ctx->reclaimer = r;
+	ctx->node = node;
+	ctx->caches = malloc( sizeof( slab_cache_t ) * r->nodes_num );
+
+	for( size_t i = 0; i < r->nodes_num; ++i )
+		slab_cache_init( &( ctx->caches[ i ] ) );
+
+	if( RECLAIM_MODE( r ) == RECLAIM_MODE_EPOCHS )
+		ebr_ctx_init( ctx );
+	else if( RECLAIM_MODE( r ) == RECLAIM_MODE_ERAS )
+		eras_ctx_init( ctx );
 
 	AO_nop_full();
 	
@@ -163,85 +499,187 @@ inline static void _ctx_put_into_list( thread_ctx_t *ctx ) {
 	ctx->reclaimer->ctx_list.next = ctx;
 
 	if( ctx->header.next != NULL )
-		ctx->header.next->prev = ctx;
+		ctx->header.next->prev = &( ctx->header );
 
 	pthread_mutex_unlock( &( ctx->reclaimer->write_guard ) );
-	fetch_and_inc( &( ctx->reclaimer->threads_num ) );
 }
 
-inline static void _ctx_remove_from_list( thread_ctx_t *ctx ) {
-	assert( ctx != NULL );
+void reclaim_hazard_add_page( thread_ctx_t *ctx ) {
+	if( ctx->hazard.pages_num == ctx->hazard.capacity ) {
+		ctx->hazard.capacity = ( ctx->hazard.capacity == 0 ) ?
+			1 :
+			ctx->hazard.capacity * 2;
+		ctx->hazard.pages = realloc( ctx->hazard.pages,
+			sizeof( hazard_page_t* ) * ctx->hazard.capacity
+		);
+		ctx->hazard.summaries = realloc( ctx->hazard.summaries,
+			sizeof( AO_t ) * ctx->hazard.capacity
+		);
+	}
 
-	pthread_mutex_lock( &( ctx->reclaimer->write_guard ) );
+	hazard_page_t *page =
+		registry_page_get( &( ctx->reclaimer->hazards ), ctx->node );
 
-	ctx->prev->next = ctx->header.next;
-	
-	if( ctx->header.next != NULL )
-		ctx->header.next->prev = ctx->prev;
+	// acquisition of a slot has no way to fail
+	if( page == NULL )
+		abort();
 
-	pthread_mutex_unlock( &( ctx->reclaimer->write_guard ) );
-	fetch_and_dec( &( ctx->reclaimer->threads_num ) );
-}
+	ctx->hazard.pages[ ctx->hazard.pages_num ] = page;
+	ctx->hazard.summaries[ ctx->hazard.pages_num ] = HAZARD_SUMMARY_FULL;
+	++ctx->hazard.pages_num;
 
-inline static void _ctx_rcu_mark_as_reader( thread_ctx_t *ctx ) {
-	ctx->list_reader_tag = AO_load( & ( ctx->reclaimer->list_reader_tag) );	
-	ctx->is_list_reader = 1;
-	_fetch_and_inc( &( ctx->reclaimer->list_reader_tag ) );
+	// registry might have replaced its directory; the old one is freed by
+	// the next scan since the thread might be inside of read-side section
+	// here (e.g. callback called by _clean_all or reclaim_help)
 }
 
-inline static void _ctx_rcu_unmark_as_reader( thread_ctx_t *ctx ) {
-	ctx->is_list_reader = 0;
+// pages stay with the context for the next thread using it on the node
+static void _hazard_release_all( thread_ctx_t *ctx ) {
+	for( size_t idx = 0; idx < ctx->hazard.pages_num; ++idx )
+		for( int w = 0; w < HAZARD_PAGE_WORDS; ++w )
+			for( AO_t occupied = ctx->hazard.pages[ idx ]->occupied[ w ];
+				occupied != 0;
+				occupied &= occupied - 1
+			)
+				_hazard_release_at( ctx,
+					idx,
+					w * POINTERS_NUMBER + ffsl( occupied ) - 1
+				);
+
 	AO_nop_full();
 }
 
-void *reclaim_deref_link( thread_ctx_t *ctx, void * volatile *ptr_to_link ) {
-	AO_t *hmap = &( ctx->hazard.map );
-	assert( *hmap != 0 );
-	void **hptrs = ctx->hazard.ptrs;
-	
-	int num = ffsl( *hmap ) - 1;
-
-	do {
-		*hmap &= ~ ( 1ul << num );
-		hptrs[ num ] = *ptr_to_link;
+// scanner side counterpart of _hazard_light_fence
+inline static void _hazard_heavy_fence( reclaimer_t *r ) {
+	if( r->flags & RECLAIM_ASYMMETRIC_FENCE )
+		membarrier_heavy();
+	else
 		AO_nop_full();
-	} while (
-		AO_load( ptr_to_link ) != hptrs[ num ]
+}
+
+void reclaim_enter( thread_ctx_t *ctx ) {
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_EPOCHS )
+		ebr_enter( ctx );
+	else if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_ERAS )
+		eras_enter( ctx );
+}
+
+void reclaim_exit( thread_ctx_t *ctx ) {
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_EPOCHS )
+		ebr_exit( ctx );
+	else if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_ERAS )
+		eras_exit( ctx );
+}
+
+// links are protected in groups of POINTERS_NUMBER; every group is
+// published with one fence and validated in one pass; links changed in
+// between are published again
+void reclaim_deref_links( thread_ctx_t *ctx,
+	void * volatile * const *ptrs_to_links,
+	void **links,
+	reclaim_hazard_t *handles,
+	size_t n
+) {
+	void **slots[ POINTERS_NUMBER ];
+
+	if( ( handles != NULL ) &&
+		( RECLAIM_MODE( ctx->reclaimer ) != RECLAIM_MODE_HAZARD_POINTERS )
 	)
+		for( size_t i = 0; i < n; ++i )
+			handles[ i ] = RECLAIM_NO_HAZARD;
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_EPOCHS ) {
+		for( size_t i = 0; i < n; ++i )
+			links[ i ] = ( void* ) AO_load( ( AO_t* ) ptrs_to_links[ i ] );
+
+		return;
+	}
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_ERAS ) {
+		for( size_t i = 0; i < n; ++i )
+			links[ i ] = eras_deref_link( ctx, ptrs_to_links[ i ] );
+
+		return;
+	}
+
+	for( size_t base = 0; base < n; base += POINTERS_NUMBER ) {
+		size_t group = ( ( n - base ) < POINTERS_NUMBER ) ?
+			( n - base ) :
+			POINTERS_NUMBER;
+
+		for( size_t i = 0; i < group; ++i ) {
+			reclaim_hazard_t h = reclaim_hazard_acquire( ctx );
+
+			if( handles != NULL )
+				handles[ base + i ] = h;
 
-	return hptrs[ num ];
+			slots[ i ] = reclaim_hazard_slot( ctx, h );
+			links[ base + i ] =
+				( void* ) AO_load( ( AO_t* ) ptrs_to_links[ base + i ] );
+			AO_store( ( AO_t* ) slots[ i ], ( AO_t ) links[ base + i ] );
+		}
+
+		for( int is_stable = 0; ! is_stable; ) {
+			_hazard_light_fence( ctx->reclaimer );
+			is_stable = 1;
+
+			for( size_t i = 0; i < group; ++i ) {
+				void *ptr = ( void* ) AO_load( ( AO_t* ) ptrs_to_links[ base + i ] );
+
+				if( ptr != links[ base + i ] ) {
+					links[ base + i ] = ptr;
+					AO_store( ( AO_t* ) slots[ i ], ( AO_t ) ptr );
+					is_stable = 0;
+				}
+			}
+		}
+	}
 }
 
 int reclaim_release_link( thread_ctx_t *ctx, void *link ) {
-	AO_t *hmap = &( ctx->hazard.map );
-	void **hptrs = ctx->hazard.ptrs;
-
-	AO_t hcyc = *hmap;
-	AO_t hstop = ~ 0ul;
-	for( int i = 0;
-		hcyc != hstop;
-		++i, hcyc >>= 1, hstop >>= 1
+	if( RECLAIM_MODE( ctx->reclaimer ) != RECLAIM_MODE_HAZARD_POINTERS )
+		return 1;
+
+	size_t left = ctx->hazard.used;
+
+	for( size_t idx = 0;
+		( idx < ctx->hazard.pages_num ) && ( left > 0 );
+		++idx
 	)
-		if( ( ! ( hcyc & 1u ) ) && ( hptrs[ i ] == link ) ) {
-			*hmap |= ( 1ul << i );
-			hptrs[ i ] = NULL;
-			AO_nop_full();
-			return 1;
-		}
+		for( int w = 0; w < HAZARD_PAGE_WORDS; ++w )
+			for( AO_t occupied = ctx->hazard.pages[ idx ]->occupied[ w ];
+				occupied != 0;
+				occupied &= occupied - 1, --left
+			) {
+				size_t slot = w * POINTERS_NUMBER + ffsl( occupied ) - 1;
+
+				if( RECLAIM_LINK_STRIP( ctx->hazard.pages[ idx ]->ptrs[ slot ] ) ==
+					RECLAIM_LINK_STRIP( link )
+				) {
+					_hazard_release_at( ctx, idx, slot );
+					_hazard_light_fence( ctx->reclaimer );
+					return 1;
+				}
+			}
 
 	return 0;
 }
 
 int reclaim_compare_and_swap_link( thread_ctx_t *ctx,
 	void **where,
-	void *old,
-	void *new
+	void *expected,
+	void *desired
 ) {
-	if( AO_compare_and_swap_full( where, old, new ) ) {
-		if( new != NULL )
-			_link_inc_ref_cnt( new );
-		if( old != NULL )
-			_link_dec_ref_cnt( old );
+	if( AO_compare_and_swap_full( ( AO_t* ) where,
+		( AO_t ) expected,
+		( AO_t ) desired
+	) ) {
+		// changing only the tag of the link doesn't change the number of
+		// references to the object
+		if( RECLAIM_LINK_STRIP( desired ) != RECLAIM_LINK_STRIP( expected ) ) {
+			_link_inc_ref_cnt( desired );
+			_link_dec_ref_cnt( expected );
+		}
 
 		return 1;
 	}
@@ -249,11 +687,12 @@ int reclaim_compare_and_swap_link( thread_ctx_t *ctx,
 	return 0;
 }
 
-#define LINK_IS_DELETED ( 1ul << ( sizeof( AO_t ) * 8 - 1 ) )
-#define LINK_IS_TRACED ( LINK_IS_DELETED >> 1 )
-
+// links might carry tags and tag-only links are treated as NULL
 inline static void _link_inc_ref_cnt( void *link ) {
-	AO_t *auxrec = _link_get_ancillary( link );
+	if( RECLAIM_LINK_STRIP( link ) == NULL )
+		return;
+
+	AO_t *auxrec = _link_get_ancillary( RECLAIM_LINK_STRIP( link ) );
 	AO_t aux;
 	
 	do {
@@ -263,57 +702,66 @@ inline static void _link_inc_ref_cnt( void *link ) {
 			aux,
 			( aux + 1 ) & ( ~LINK_IS_TRACED )
 		)
-	)
-}
-
-inline static AO_t *_link_get_ancillary( void *link ) {
-	return ( AO_t*  ) ( ( ( char* ) link ) - sizeof( AO_t ) );
+	);
 }
 
 inline static void _link_dec_ref_cnt( void *link ) {
-	fetch_and_dec( ( ( char* ) link ) - sizeof( AO_t ) );
+	if( RECLAIM_LINK_STRIP( link ) == NULL )
+		return;
+
+	fetch_and_dec( _link_get_ancillary( RECLAIM_LINK_STRIP( link ) ) );
 }
 
 void reclaim_store_link( thread_ctx_t *ctx, void **where, void *link ) {
 	void *old = *where;
 	*where = link;
 
-	if( link != NULL )
-		_link_inc_ref_cnt( new );
-	if( old != NULL )
+	if( RECLAIM_LINK_STRIP( link ) != RECLAIM_LINK_STRIP( old ) ) {
+		_link_inc_ref_cnt( link );
 		_link_dec_ref_cnt( old );
+	}
 }
 
 void *reclaim_alloc( thread_ctx_t *ctx ) {
-	char *res;
+	if( _budget_is_exceeded( ctx->reclaimer ) )
+		_budget_help( ctx );
 
-	posix_memalign( &res,
-		ctx->reclaimer->instance.align,
-		ctx->reclaimer->instance.size + ctx->reclaimer->instance.align
+	char *res = slab_alloc( &( ctx->reclaimer->pools[ ctx->node ] ),
+		&( ctx->caches[ ctx->node ] )
 	);
 
+	if( res == NULL )
+		return NULL;
+
 	res += ctx->reclaimer->instance.align;
 	*( ( AO_t* ) ( res - sizeof( AO_t ) ) ) = 0;
-	reclaim_deref_link( ctx, &res );
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_HAZARD_POINTERS )
+		reclaim_deref_link( ctx, ( void** ) &res );
+	else if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_ERAS )
+		eras_stamp_birth( ctx, res );
 	
 	return res;
 }
 
-void reclaim_free( thread_ctx_t *ctx, void *what ) {
-	assert( ctx->deleted.ptrs_number < ctx->deleted.capacity );
+// policy decides when to scan; escalations are still bound to the number
+// of hazards threads can hold since they are what breaks claims and
+// guarantees progress of the scan
+static void _reclaim_check_threshold( thread_ctx_t *ctx ) {
+	reclaim_policy_t *policy = &( ctx->reclaimer->policy );
+	size_t backlog = ctx->deleted->ptrs_number;
 
-	reclaim_release_link( ctx, what );
-	_link_mark_as_deleted( what );
-	rope_owner_put( ctx->deleted, what );
+	if( ! policy->is_due( ctx, backlog ) )
+		return;
 
-	if( ctx->deleted->ptrs_number >=
-		AO_load( &( ctx->reclaimer->threads_num ) ) * POINTERS_NUMBER
-	)
-		_scan( ctx );
+	AO_t reclaimed = ctx->stats.reclaimed;
+
+	_scan( ctx );
 
 	if( ctx->deleted->ptrs_number >=
 		AO_load( &( ctx->reclaimer->threads_num ) ) * POINTERS_NUMBER
 	) {
+		_stats_add( &( ctx->stats.clean_local ), 1 );
 		_clean_local( ctx );
 		_scan( ctx );
 	}
@@ -321,133 +769,638 @@ void reclaim_free( thread_ctx_t *ctx, void *what ) {
 	if( ctx->deleted->ptrs_number >=
 		AO_load( &( ctx->reclaimer->threads_num ) ) * POINTERS_NUMBER
 	) {
+		_stats_add( &( ctx->stats.clean_all ), 1 );
 		_clean_all( ctx );
 		_scan( ctx );
 	}
+
+	if( policy->scanned != NULL )
+		policy->scanned( ctx, backlog, ctx->stats.reclaimed - reclaimed );
 }
 
-static inline void _link_mark_as_deleted( void *what ) {
-	AO_t *auxrec = _link_get_ancillary( what );
-	AO_t aux;
-	
-	do {
-		aux = AO_load( auxrec );
-	} while (
-		! AO_compare_and_swap_full( auxrec,
-			aux,
-			aux | LINK_IS_DELETED & ( ~LINK_IS_TRACED )
-		)
+// retires objects according to reclamation mode; links are released by
+// the caller
+static void _retire_n( thread_ctx_t *ctx, void * const *what, size_t n ) {
+	// backlog is sampled before reclamation attempt which might follow
+	_stats_max( &( ctx->stats.backlog_peak ), _ctx_backlog( ctx ) + n );
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_EPOCHS ) {
+		ebr_retire( ctx, what, n );
+		return;
+	}
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_ERAS ) {
+		eras_retire( ctx, what, n );
+		return;
+	}
+
+	for( size_t i = 0; i < n; ++i )
+		_link_mark_as_deleted( what[ i ] );
+
+	if( n == 1 )
+		rope_owner_put( ctx->deleted, what[ 0 ] );
+	else
+		rope_owner_put_n( ctx->deleted, what, n );
+
+	_reclaim_check_threshold( ctx );
+}
+
+// moves objects from the rope of orphan to own deletion list; objects
+// claimed by _clean_all at the moment are left for the next attempt
+static void _ctx_adopt_rope( thread_ctx_t *own_ctx, rope_t *rope ) {
+	void *batch[ POINTERS_NUMBER ];
+	size_t n = 0;
+	rope_ptr_t iter;
+	void *ptr;
+
+	_rope_claim( own_ctx, rope );
+
+	for( int cont = rope_iterator_create( rope, &iter );
+		cont;
+		cont = rope_iterator_next( &iter )
+	) {
+		ptr = rope_owner_iterator_deref( &iter );
+
+		if( ! rope_owner_delete( rope, &iter ) )
+			continue;
+
+		batch[ n++ ] = ptr;
+
+		if( n == POINTERS_NUMBER ) {
+			_retire_n( own_ctx, batch, n );
+			n = 0;
+		}
+	}
+
+	_rope_unclaim( own_ctx, rope );
+
+	if( n > 0 )
+		_retire_n( own_ctx, batch, n );
+}
+
+// one orphan is adopted per call; contexts are only prepended to ctx_list
+// and never freed while reclaimer is alive so the list is walked without
+// read-side section
+static void _ctx_adopt_orphans( thread_ctx_t *own_ctx ) {
+	reclaimer_t *r = own_ctx->reclaimer;
+	thread_ctx_t *orphan;
+
+	for( orphan = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( r->ctx_list.next ) );
+		orphan != NULL;
+		orphan = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( orphan->header.next ) )
 	)
+		if( AO_compare_and_swap_full( &( orphan->state ),
+			CTX_ORPHAN,
+			CTX_ADOPTING
+		) )
+			break;
+
+	if( orphan == NULL )
+		return;
+
+	if( RECLAIM_MODE( r ) == RECLAIM_MODE_EPOCHS )
+		for( size_t i = 0;
+			i < sizeof( orphan->ebr.bags ) / sizeof( orphan->ebr.bags[ 0 ] );
+			++i
+		)
+			_ctx_adopt_rope( own_ctx, orphan->ebr.bags[ i ] );
+	else
+		_ctx_adopt_rope( own_ctx, orphan->deleted );
+
+	if( _ctx_backlog( orphan ) > 0 )
+		AO_store_full( &( orphan->state ), CTX_ORPHAN );
+	else {
+		fetch_and_dec( &( r->orphans_num ) );
+		AO_store_full( &( orphan->state ), CTX_PARKED );
+	}
+}
+
+void reclaim_free( thread_ctx_t *ctx, void *what ) {
+	reclaim_free_n( ctx, &what, 1 );
+}
+
+// number of attempts to reclaim and waits made by the thread over budget
+// before it goes on regardless; waits are bounded so threads which hold
+// hazards or critical sections themselves can't deadlock
+#ifndef RECLAIM_BUDGET_WAIT_ROUNDS
+	#define RECLAIM_BUDGET_WAIT_ROUNDS 8
+#endif
+
+static const struct timespec _budget_wait_timeout = {
+	.tv_sec = 0,
+	.tv_nsec = 1000000
+};
+
+// thread over budget reclaims its own backlog, takes over backlogs of
+// orphans and releases links held by objects in deletion lists of others
+// so that their scans succeed; it waits for others only outside of
+// critical sections since they would hold back epochs and eras; thread
+// with offloading on never scans nor calls callbacks so it only waits
+// for workers
+static void _budget_help( thread_ctx_t *ctx ) {
+	reclaimer_t *r = ctx->reclaimer;
+	int is_offloaded = ( ctx->offload.worker != NULL );
+	int may_wait = ! ctx->budget.no_wait &&
+		( ctx->ebr.nesting == 0 ) &&
+		( ctx->eras.nesting == 0 );
+
+	for( int round = 0; round < RECLAIM_BUDGET_WAIT_ROUNDS; ++round ) {
+		if( ! is_offloaded ) {
+			if( AO_load( &( r->orphans_num ) ) > 0 )
+				_ctx_adopt_orphans( ctx );
+
+			reclaim_collect( ctx );
+			reclaim_help( ctx );
+
+			if( RECLAIM_MODE( r ) == RECLAIM_MODE_HAZARD_POINTERS ) {
+				_stats_add( &( ctx->stats.clean_all ), 1 );
+				_clean_all( ctx );
+			}
+		}
+
+		_budget_publish( ctx );
+
+		if( ! may_wait || ! _budget_is_exceeded( r ) )
+			return;
+
+		// flag is set before the budget is checked again so either
+		// the thread sees the value under the limit or the publisher sees
+		// the flag
+		AO_int_store( &( r->budget.waiters ), 1 );
+		AO_nop_full();
+
+		if( ! _budget_is_exceeded( r ) )
+			return;
+
+		futex_wait_timeout( &( r->budget.waiters ), 1, &_budget_wait_timeout );
+	}
+}
+
+void reclaim_set_budget( reclaimer_t *r, size_t bytes ) {
+	assert( r != NULL );
+
+	AO_store_full( &( r->budget.limit ), bytes );
+
+	// waiters are released if the limit is raised or removed
+	AO_int_store( &( r->budget.waiters ), 0 );
+	futex_wake_all( &( r->budget.waiters ) );
+}
+
+size_t reclaim_get_unreclaimed_bytes( reclaimer_t *r ) {
+	assert( r != NULL );
+
+	long bytes = ( long ) AO_load( &( r->budget.unreclaimed ) );
+
+	return ( bytes > 0 ) ? ( size_t ) bytes : 0;
+}
+
+void reclaim_free_n( thread_ctx_t *ctx, void * const *what, size_t n ) {
+	if( _budget_is_exceeded( ctx->reclaimer ) )
+		_budget_help( ctx );
+
+	if( ctx->offload.worker != NULL ) {
+		for( size_t i = 0; i < n; ++i )
+			reclaim_release_link( ctx, what[ i ] );
+
+		workers_offload( ctx, what, n );
+		return;
+	}
+
+	if( AO_load( &( ctx->reclaimer->orphans_num ) ) > 0 )
+		_ctx_adopt_orphans( ctx );
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_HAZARD_POINTERS )
+		for( size_t i = 0; i < n; ++i )
+			reclaim_release_link( ctx, what[ i ] );
+
+	// offloaded batches return above and are counted and accounted by
+	// the worker when it retires them here; adopted objects were counted
+	// and accounted by their first owner so it's done here rather than in
+	// _retire_n
+	_stats_add( &( ctx->stats.retired ), n );
+	_budget_account( ctx, ( long ) ( n * INSTANCE_BYTES( ctx->reclaimer ) ) );
+	_retire_n( ctx, what, n );
 }
 
 #define IS_HAZARDED ( 1ul )
 
-static void _scan( thread_ctx_t *own_ctx ) {
-	AO_t anc_block;
-	AO_t *anc_ptr;
-	
+// relative costs of loading one hazard pointer published by another thread
+// (K in README) and one pointer from our own deletion list (k in README)
+#ifndef SCAN_HAZARD_LOAD_COST
+	#define SCAN_HAZARD_LOAD_COST 4
+#endif
+
+#ifndef SCAN_DELETED_LOAD_COST
+	#define SCAN_DELETED_LOAD_COST 1
+#endif
+
+// relative cost of one probe into hazard pointer hash set
+#ifndef SCAN_HASH_PROBE_COST
+	#define SCAN_HASH_PROBE_COST 2
+#endif
+
+enum _scan_strategy {
+	SCAN_SORT_DELETED = 0,
+	SCAN_HASH_HAZARDS = 1
+};
+
+inline static size_t _log2_ceil( size_t n ) {
+	return ( n > 1 ) ? ( sizeof( size_t ) * 8 - __builtin_clzl( n - 1 ) ) : 1;
+}
+
+// chooses the cheaper way to intersect deletion list with hazard set
+// according to the cost model from README where sorting of the hazard set
+// is replaced with hashing (linear in both sets); the number of hazards is
+// estimated from the occupancy observed during the previous scan scaled
+// to the current number of threads
+static int _scan_choose_strategy( thread_ctx_t *own_ctx ) {
+	size_t threads_num = AO_load( &( own_ctx->reclaimer->threads_num ) );
+	size_t ndel = own_ctx->deleted->ptrs_number;
+	size_t nhazards;
+
+	if( own_ctx->scan.threads_num == 0 )
+		nhazards = threads_num * POINTERS_NUMBER;
+	else
+		nhazards = own_ctx->scan.hazards_num * threads_num /
+			own_ctx->scan.threads_num;
+
+	if( nhazards == 0 )
+		return SCAN_HASH_HAZARDS;
+
+	size_t hash_hazards_cost =
+		nhazards * ( SCAN_HAZARD_LOAD_COST + SCAN_HASH_PROBE_COST ) +
+		ndel * ( SCAN_DELETED_LOAD_COST + SCAN_HASH_PROBE_COST );
+	size_t sort_deleted_cost = ndel * SCAN_DELETED_LOAD_COST +
+		( ndel + nhazards * SCAN_HAZARD_LOAD_COST ) * _log2_ceil( ndel );
+
+	return ( hash_hazards_cost < sort_deleted_cost ) ?
+		SCAN_HASH_HAZARDS :
+		SCAN_SORT_DELETED;
+}
+
+inline static void _trace_one( void *ptr ) {
+	AO_t *anc_ptr = _link_get_ancillary( ptr );
+	AO_t anc_block = AO_load( anc_ptr );
+
+	if( ( anc_block &
+		( ~ ( LINK_IS_TRACED | LINK_IS_DELETED | LINK_IS_TERMINATED ) ) ) == 0
+	)
+		AO_compare_and_swap( anc_ptr,
+			anc_block,
+			anc_block | LINK_IS_TRACED
+		);
+}
+
+static void _scan_trace( thread_ctx_t *own_ctx ) {
+	rope_run_t run;
 	rope_ptr_t iter;
-	for( int cont = rope_iterator_create( own_ctx->deleted, &iter );
+	for( int cont = rope_run_first( own_ctx->deleted, &run );
 		cont;
-		cont = rope_iterator_next( &iter );
-	) {
-		anc_ptr = _link_get_ancillary( rope_owner_iterator_deref( &iter ) );
-		anc_block = AO_load( anc_ptr );
+		cont = rope_run_next( &run )
+	)
+		for( size_t i = 0; i < run.len; ++i ) {
+			rope_iterator_create_with( &iter, run.chunk, run.idx + i );
+			_trace_one( rope_owner_iterator_deref( &iter ) );
+		}
+}
 
-		if( ( anc_block & ( ~ ( LINK_IS_TRACED | LINK_IS_DELETED ) ) ) == 0 )
-			AO_compare_and_swap( anc_ptr,
-				anc_block,
-				anc_block | LINK_IS_TRACED
-			);
+// object claimed by somebody stays in the list; it's terminated by every
+// scan finding it so but counted only by the first one
+static void _object_terminate( thread_ctx_t *ctx, void *ptr ) {
+	AO_t *auxrec = _link_get_ancillary( ptr );
+	AO_t aux;
+
+	ctx->reclaimer->callbacks.terminate( ptr, 1 );
+
+	do {
+		aux = AO_load( auxrec );
+
+		if( aux & LINK_IS_TERMINATED )
+			return;
+	} while(
+		! AO_compare_and_swap_full( auxrec, aux, aux | LINK_IS_TERMINATED )
+	);
+
+	_stats_add( &( ctx->stats.terminated ), 1 );
+}
+
+// returns 1 if object has been freed
+inline static int _scan_release( thread_ctx_t *own_ctx,
+	void *ptr,
+	rope_chunk_t *chunk,
+	size_t idx
+) {
+	AO_t anc_block = AO_load( _link_get_ancillary( ptr ) );
+
+	if( ( anc_block & ( ~ ( LINK_IS_DELETED | LINK_IS_TERMINATED ) ) ) !=
+		LINK_IS_TRACED
+	)
+		return 0;
+
+	if( rope_owner_delete_at( own_ctx->deleted, chunk, idx ) ) {
+		_object_dispose( own_ctx, ptr );
+		return 1;
 	}
 
+	_object_terminate( own_ctx, ptr );
+	return 0;
+}
+
+static void _scan_sort_deleted( thread_ctx_t *own_ctx ) {
 	sorted_rope_t ptr_set;
 	rope_owner_sort( own_ctx->deleted, &ptr_set );
 
-	void **hptrs = NULL;
-	AO_t hcyc = NULL;
-	AO_t hstop = ~ 0ul;
+	hazard_iter_t hiter;
 	void *ptr = NULL;
 	shadow_ptr_t *sptr;
+	size_t hazards_num = 0;
 
+	_hazard_heavy_fence( own_ctx->reclaimer );
 	_ctx_rcu_mark_as_reader( own_ctx );
 
-	for( thread_ctx_t *ctx = AO_load( &( own_ctx->reclaimer->ctx_list.next ) );
-		ctx != NULL;
-		ctx = AO_load( &( ctx->next ) );
-	) {
-		hptrs = ctx->hazard.ptrs;
-		hcyc = AO_load( &( ctx->hazard.map ) );
-		hstop = ~ 0ul;
-		for( int i = 0;
-			hcyc != hstop;
-			++i, hcyc >>= 1, hstop >>= 1
-		)
-			if( ( ! ( hcyc & 1u ) ) &&
-				( ( ptr = AO_load( &( hptrs[ i ] ) ) ) != NULL ) &&
-				( ( sptr = rope_owner_find( &ptr_set, ptr ) ) != NULL )
-			) 
-				sptr->ptr |= IS_HAZARDED;
+	// directory of the registry can be replaced and retired meanwhile;
+	// RCU read-side section keeps it alive
+	registry_iter_init( &hiter, &( own_ctx->reclaimer->hazards ) );
+
+	while( ( ptr = registry_iter_next( &hiter ) ) != NULL ) {
+		++hazards_num;
+		ptr = RECLAIM_LINK_STRIP( ptr );
+
+		if( ( sptr = rope_owner_find( &ptr_set, ptr ) ) != NULL )
+			sptr->ptr = ( void* ) ( ( AO_t ) sptr->ptr | IS_HAZARDED );
 	}
 	
-	_ctx_rcu_unmark_as_reader( ctx );
+	_ctx_rcu_unmark_as_reader( own_ctx );
+
+	own_ctx->scan.hazards_num = hazards_num;
 
-	void ( *terminate )( void *ptr, int is_concurrent ) =
-		own_ctx->reclaimer->callbacks.terminate;
-	for( int i = 0;
+	for( size_t i = 0;
 		i < ptr_set.ptrs_number;
 		++i
 	)
-		if( ! ( ptr_set.ptrs[ i ] & IS_HAZARDED ) ) {
-			anc_ptr = _link_get_ancillary( ptr_set.ptrs[ i ].ptr );
-			anc_block = AO_load( anc_ptr );
-
-			if( ( anc_block & ( ~ LINK_IS_DELETED ) ) == LINK_IS_TRACED ) {
-				if( rope_owner_delete_at(
-					own_ctx->rope,
-					ptr_set.ptrs[ i ].chunk,
-					ptr_set.ptrs[ i ].idx
-				) ) {
-					terminate( ptr_set.ptrs[ i ].ptr, 0 );
-					free( ptr_set.ptrs[ i ].ptr );
-				} else
-					terminate( ptr_set.ptrs[ i ].ptr, 1 );
-			}
+		if( ! ( ( AO_t ) ptr_set.ptrs[ i ].ptr & IS_HAZARDED ) )
+			_scan_release( own_ctx,
+				ptr_set.ptrs[ i ].ptr,
+				ptr_set.ptrs[ i ].chunk,
+				ptr_set.ptrs[ i ].idx
+			);
+}
+
+static void _scan_hash_hazards( thread_ctx_t *own_ctx ) {
+	hazard_iter_t hiter;
+	void *ptr = NULL;
+	size_t hazards_num = 0;
+	ptrset_t *hazards = &( own_ctx->scan.hazards );
+
+	ptrset_reset( hazards, own_ctx->scan.hazards_num );
+
+	_hazard_heavy_fence( own_ctx->reclaimer );
+	_ctx_rcu_mark_as_reader( own_ctx );
+	registry_iter_init( &hiter, &( own_ctx->reclaimer->hazards ) );
+
+	while( ( ptr = registry_iter_next( &hiter ) ) != NULL ) {
+		++hazards_num;
+		ptrset_insert( hazards, RECLAIM_LINK_STRIP( ptr ) );
+	}
+	
+	_ctx_rcu_unmark_as_reader( own_ctx );
+
+	own_ctx->scan.hazards_num = hazards_num;
+
+	// runs are taken before releasing so freeing slots doesn't disturb
+	// the walk
+	rope_run_t run;
+	rope_ptr_t iter;
+	for( int cont = rope_run_first( own_ctx->deleted, &run );
+		cont;
+		cont = rope_run_next( &run )
+	)
+		for( size_t i = 0; i < run.len; ++i ) {
+			rope_iterator_create_with( &iter, run.chunk, run.idx + i );
+			ptr = rope_owner_iterator_deref( &iter );
+
+			if( ! ptrset_contains( hazards, ptr ) )
+				_scan_release( own_ctx, ptr, iter.chunk, iter.idx );
 		}
 }
 
+static void _scan( thread_ctx_t *own_ctx ) {
+	uint64_t start = _stats_scan_begin();
+
+	_rope_claim( own_ctx, own_ctx->deleted );
+	_scan_trace( own_ctx );
+
+	// strategy must be chosen before the sampling of threads number below
+	// since the latter is the base for the next estimation
+	int strategy = _scan_choose_strategy( own_ctx );
+	own_ctx->scan.threads_num =
+		AO_load( &( own_ctx->reclaimer->threads_num ) );
+
+	if( strategy == SCAN_HASH_HAZARDS )
+		_scan_hash_hazards( own_ctx );
+	else
+		_scan_sort_deleted( own_ctx );
+
+	_rope_unclaim( own_ctx, own_ctx->deleted );
+
+	// memory grown by a burst is returned once the backlog drains;
+	// _clean_all of other threads might be walking through the chunks
+	// being detached
+	rope_owner_shrink( own_ctx->deleted );
+	_ctx_free_deferred( own_ctx );
+
+	_stats_scan_end( own_ctx, start );
+}
+
+void reclaim_collect( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+
+	if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_EPOCHS )
+		ebr_collect( ctx );
+	else if( RECLAIM_MODE( ctx->reclaimer ) == RECLAIM_MODE_ERAS )
+		eras_collect( ctx );
+	else
+		_scan( ctx );
+}
+
 static void _clean_all( thread_ctx_t *own_ctx ) {
 	void ( *clean_up )( void *ptr ) = own_ctx->reclaimer->callbacks.clean_up;
 	
 	_ctx_rcu_mark_as_reader( own_ctx );
 
+	rope_run_t run;
 	rope_ptr_t iter;
 	void *ptr = NULL;
-	for( thread_ctx_t *ctx = AO_load( &( own_ctx->reclaimer->ctx_list.next ) );
+	for( thread_ctx_t *ctx = ( thread_ctx_t* ) AO_load(
+			( AO_t* ) &( own_ctx->reclaimer->ctx_list.next )
+		);
 		ctx != NULL;
-		ctx = AO_load( &( ctx->next ) );
+		ctx = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( ctx->header.next ) )
 	)
-		for( int cont = rope_iterator_create( ctx->deleted, &iter );
+		for( int cont = rope_run_first( ctx->deleted, &run );
 			cont;
-			cont = rope_iterator_next( &iter )
+			cont = rope_run_next( &run )
 		)
-			if( ( ptr = rope_alien_iterator_deref( &iter ) ) != NULL ) {
-				clean_up( ptr );
-				rope_alien_iterator_release( &iter );
+			for( size_t i = 0; i < run.len; ++i ) {
+				rope_iterator_create_with( &iter, run.chunk, run.idx + i );
+
+				if( ( ptr = rope_alien_iterator_deref( &iter ) ) != NULL ) {
+					clean_up( ptr );
+					rope_alien_iterator_release( &iter );
+				}
 			}
 
-	_ctx_rcu_unmark_as_reader( ctx );
+	_ctx_rcu_unmark_as_reader( own_ctx );
 }
 
 static void _clean_local( thread_ctx_t *ctx ) {
 	void ( *clean_up )( void *ptr ) = ctx->reclaimer->callbacks.clean_up;
 
+	_rope_claim( ctx, ctx->deleted );
+
+	rope_run_t run;
 	rope_ptr_t iter;
 	void *ptr = NULL;
-	for( int cont = rope_iterator_create( ctx->deleted, &iter );
+	for( int cont = rope_run_first( ctx->deleted, &run );
 		cont;
-		cont = rope_iterator_next( &iter )
+		cont = rope_run_next( &run )
 	)
-		if( ( ptr = rope_owner_iterator_deref( &iter ) ) != NULL )
-			clean_up( ptr );
+		for( size_t i = 0; i < run.len; ++i ) {
+			rope_iterator_create_with( &iter, run.chunk, run.idx + i );
+
+			if( ( ptr = rope_owner_iterator_deref( &iter ) ) != NULL )
+				clean_up( ptr );
+		}
+
+	_rope_unclaim( ctx, ctx->deleted );
+}
+
+// number of chunks of other threads claimed by one reclaim_help call
+#ifndef RECLAIM_STEAL_CHUNKS
+	#define RECLAIM_STEAL_CHUNKS 8
+#endif
+
+inline static void _steal_push( thread_ctx_t *own_ctx,
+	size_t idx,
+	void *ptr,
+	rope_chunk_t *chunk,
+	size_t slot
+) {
+	if( idx == own_ctx->steal.capacity ) {
+		own_ctx->steal.capacity = ( own_ctx->steal.capacity == 0 ) ?
+			POINTERS_NUMBER :
+			own_ctx->steal.capacity * 2;
+		own_ctx->steal.candidates = realloc( own_ctx->steal.candidates,
+			sizeof( shadow_ptr_t ) * own_ctx->steal.capacity
+		);
+	}
+
+	own_ctx->steal.candidates[ idx ] = ( shadow_ptr_t ) {
+		.ptr = ptr,
+		.idx = slot,
+		.chunk = chunk
+	};
+}
+
+// claims chunks of other threads and collects objects there; they are
+// traced before the hazard snapshot is taken the same way _scan does;
+// contexts and chunks (even detached by shrinking) stay alive inside
+// ctx_list read-side section and owners can't touch claimed slots
+static size_t _steal( thread_ctx_t *own_ctx ) {
+	reclaimer_t *r = own_ctx->reclaimer;
+	rope_chunk_t *chunks[ RECLAIM_STEAL_CHUNKS ];
+	size_t chunks_num = 0, cands_num = 0, freed = 0;
+	ptrset_t *hazards = &( own_ctx->scan.hazards );
+	hazard_iter_t hiter;
+	rope_run_t run;
+	rope_ptr_t iter;
+	void *ptr;
+
+	_ctx_rcu_mark_as_reader( own_ctx );
+
+	for( thread_ctx_t *ctx = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( r->ctx_list.next ) );
+		( ctx != NULL ) && ( chunks_num < RECLAIM_STEAL_CHUNKS );
+		ctx = ( thread_ctx_t* ) AO_load( ( AO_t* ) &( ctx->header.next ) )
+	) {
+		if( ( ctx == own_ctx ) ||
+			( AO_load( ( AO_t* ) &( ctx->deleted->ptrs_number ) ) == 0 )
+		)
+			continue;
+
+		for( rope_chunk_t *chunk = &( ctx->deleted->first_chunk );
+			( chunk != NULL ) && ( chunks_num < RECLAIM_STEAL_CHUNKS );
+			chunk = ( rope_chunk_t* ) AO_load( ( AO_t* ) &( chunk->next ) )
+		) {
+			if( ! rope_chunk_try_claim( chunk ) )
+				continue;
+
+			chunks[ chunks_num++ ] = chunk;
+			run = ( rope_run_t ) { .chunk = chunk, .idx = 0, .len = 0 };
+
+			while( rope_run_next( &run ) && ( run.chunk == chunk ) )
+				for( size_t i = 0; i < run.len; ++i ) {
+					rope_iterator_create_with( &iter, chunk, run.idx + i );
+
+					// tombstones and slots being freed by the owner
+					if( ( ptr = rope_owner_iterator_deref( &iter ) ) == NULL )
+						continue;
+
+					_trace_one( ptr );
+					_steal_push( own_ctx, cands_num++, ptr, chunk, iter.idx );
+				}
+		}
+	}
+
+	if( cands_num > 0 ) {
+		ptrset_reset( hazards, own_ctx->scan.hazards_num );
+		_hazard_heavy_fence( r );
+		registry_iter_init( &hiter, &( r->hazards ) );
+
+		// the count of the last scan is only a size hint here; it's left
+		// to _scan since thresholds of the policy are derived from it
+		while( ( ptr = registry_iter_next( &hiter ) ) != NULL )
+			ptrset_insert( hazards, RECLAIM_LINK_STRIP( ptr ) );
+	}
+
+	for( size_t i = 0; i < cands_num; ++i ) {
+		shadow_ptr_t *cand = &( own_ctx->steal.candidates[ i ] );
+
+		if( ptrset_contains( hazards, cand->ptr ) ||
+			( ( AO_load( _link_get_ancillary( cand->ptr ) ) &
+				( ~ ( LINK_IS_DELETED | LINK_IS_TERMINATED ) ) ) !=
+					LINK_IS_TRACED )
+		)
+			continue;
+
+		rope_iterator_create_with( &iter, cand->chunk, cand->idx );
+
+		if( rope_alien_delete( &iter ) ) {
+			_object_dispose( own_ctx, cand->ptr );
+			++freed;
+		} else
+			_object_terminate( own_ctx, cand->ptr );
+	}
+
+	for( size_t i = 0; i < chunks_num; ++i )
+		rope_chunk_unclaim( chunks[ i ] );
+
+	_ctx_rcu_unmark_as_reader( own_ctx );
+
+	_stats_add( &( own_ctx->stats.stolen ), freed );
+
+	return freed;
+}
+
+size_t reclaim_help( thread_ctx_t *ctx ) {
+	assert( ctx != NULL );
+
+	if( ! ( ctx->reclaimer->flags & RECLAIM_WORK_STEALING ) )
+		return 0;
+
+	size_t freed = _steal( ctx );
+
+	// threads waiting for the budget are woken as soon as possible
+	_budget_publish( ctx );
+
+	return freed;
 }
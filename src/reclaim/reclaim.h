@@ -2,84 +2,429 @@
 #define LIBRECLAIM
 
 #include <atomic_ops.h>
+#include <stdint.h>
 #include <pthread.h>
 
-// TODO: Time bomb: fixed number of elements in deletion list
-// Just to push development further, I'm leaving this to-do
+#include <utils/rope.h>
+#include <utils/ptrset.h>
+#include <utils/slab.h>
+#include <utils/spsc.h>
+#include <utils/cacheline.h>
+#include <utils/numa.h>
 
-#define POINTERS_NUMBER ( sizeof( AO_t ) * 8 )
+#include <reclaim/registry.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// flags for reclaim_init
+
+// readers publish hazard pointers with compiler barrier only while
+// scanners issue membarrier(2) before reading them; silently ignored if
+// membarrier isn't supported
+#define RECLAIM_ASYMMETRIC_FENCE ( 1 << 0 )
+
+// threads calling reclaim_help (workers when idle, threads over budget)
+// claim chunks of deletion lists of other threads and reclaim objects
+// there; owners claim their chunks for scans and wait for helpers to
+// leave them; silently ignored in modes other than hazard pointers
+#define RECLAIM_WORK_STEALING ( 1 << 1 )
+
+// reclamation scheme; one of the following values
+#define RECLAIM_MODE_MASK ( 3 << 8 )
+// hazard pointers (default)
+#define RECLAIM_MODE_HAZARD_POINTERS ( 0 << 8 )
+// epoch-based reclamation; links are dereferenced with plain loads inside
+// critical sections marked by reclaim_enter and reclaim_exit
+#define RECLAIM_MODE_EPOCHS ( 1 << 8 )
+// interval-based reclamation; objects are stamped with birth and retire
+// eras, readers publish the range of eras observed inside critical section
+// marked by reclaim_enter and reclaim_exit and issue a fence only if
+// global era has changed; unlike epochs, stalled reader holds back only
+// objects which were alive during its critical section; it's one interval
+// per thread rather than an era per hazard slot so dereference doesn't
+// take slots and reclaim_release_link is a no-op
+#define RECLAIM_MODE_ERAS ( 2 << 8 )
+
+// number of buckets in histogram of scan durations; bucket i counts scans
+// which took [ 2^i, 2^(i+1) ) microseconds, the first and the last ones
+// also take everything below and above
+#ifndef RECLAIM_STATS_BUCKETS
+	#define RECLAIM_STATS_BUCKETS 16
+#endif
+
+// counters aggregated over all the thread contexts since reclaim_init;
+// peaks are maximums of per-thread values
+typedef struct {
+	size_t threads_num;
+	size_t retired;
+	size_t reclaimed;
+	size_t scans;
+	// escalations of reclamation in reclaim_free
+	size_t clean_local;
+	size_t clean_all;
+	// objects terminated because somebody held a claim on them in deletion
+	// list and not freed yet; every object is counted once however many
+	// scans find it claimed
+	size_t terminated;
+	// objects reclaimed on behalf of other threads; they are counted in
+	// reclaimed as well
+	size_t stolen;
+	size_t backlog_peak;
+	size_t hazards_peak;
+	size_t scan_hist[ RECLAIM_STATS_BUCKETS ];
+} reclaim_stats_t;
+
+// objects are aligned at least on pointer size so the lowest bits of
+// links are free for tags (e.g. deletion marks); protection, scans and
+// reference counting of links ignore them
+#define RECLAIM_LINK_TAG_MASK ( ( AO_t ) ( sizeof( void* ) - 1 ) )
+#define RECLAIM_LINK_STRIP( link ) \
+	( ( void* ) ( ( AO_t ) ( link ) & ( ~ RECLAIM_LINK_TAG_MASK ) ) )
+
+typedef struct _reclaimer_t reclaimer_t;
+typedef struct _thread_ctx_t thread_ctx_t;
+
+// reclamation trigger policy; it's asked after every retirement whether
+// the thread should try to reclaim its deletion list (scan in
+// RECLAIM_MODE_HAZARD_POINTERS and RECLAIM_MODE_ERAS, epoch advance in
+// RECLAIM_MODE_EPOCHS); backlog is the number of objects in the list;
+// scanned is optional feedback with the number of objects the attempt
+// has actually freed
+typedef struct {
+	int ( *is_due )( thread_ctx_t *ctx, size_t backlog );
+	void ( *scanned )( thread_ctx_t *ctx, size_t backlog, size_t reclaimed );
+	// objects, bytes or microseconds depending on the policy
+	size_t param;
+} reclaim_policy_t;
 
 typedef struct _thread_list_t {
 	thread_ctx_t *next;
 } thread_list_t;
 
+// background reclamation thread; it serves offload queues of the threads
+// assigned to it
 typedef struct {
+	pthread_t thread;
+	reclaimer_t *reclaimer;
+	// protects the array of assigned contexts; never held while objects
+	// are reclaimed
+	pthread_mutex_t guard;
+	size_t ctxs_num;
+	size_t capacity;
+	thread_ctx_t **ctxs;
+} reclaim_worker_t;
+
+struct _reclaimer_t {
+	int flags;
+	// unique over the process lifetime; keys the context cache of threads
+	AO_t id;
 	pthread_key_t thread_ctx;
+	// thread context list (ctx_list) is RCU; writers are serialized by
+	// the mutex and wait for readers holding it
 	pthread_mutex_t write_guard;
-	// thread context list (ctx_list) is RCU; following value is used for
-	// readers "tagging"
-	AO_t list_reader_tag;
-	AO_t writers_num;
 	
 	struct {
 		void ( *terminate )( void *ptr, int is_concurrent );
 		void ( *clean_up )( void *ptr );
 	} callbacks;
+
+	reclaim_policy_t policy;
+
+	// memory held by retired objects of all the threads; threads account
+	// their changes locally and publish them in batches so the value is
+	// approximate; limit 0 means there is no budget; threads over budget
+	// sleep on waiters until somebody brings the value under the limit
+	struct {
+		AO_t limit;
+		AO_t unreclaimed CACHE_ALIGNED;
+		volatile unsigned int waiters;
+	} budget;
 	
 	struct {
 		size_t size;
 		size_t align;
 	} instance;
 
+	// instances are allocated from the pool of the node the thread runs
+	// on and return to the pool they came from; size of every object
+	// includes ancillary block of instance.align bytes
+	size_t nodes_num;
+	slab_t *pools;
+
+	// number of active contexts and number of parked ones which still
+	// have objects to reclaim
 	AO_t threads_num;
+	AO_t orphans_num;
 	thread_list_t ctx_list;
-} reclaimer_t;
+	// contexts of finished threads (parked and orphans) which can be
+	// handed over to new threads; one stack per node of the contexts,
+	// protected by write_guard
+	thread_ctx_t **parked;
 
-typedef struct {
+	// hazard pages of all the threads
+	hazard_registry_t hazards;
+
+	// global epoch for RECLAIM_MODE_EPOCHS
+	AO_t epoch;
+	// global era for RECLAIM_MODE_ERAS
+	AO_t era;
+
+	struct {
+		size_t num;
+		AO_t is_running;
+		AO_t next;
+		reclaim_worker_t *array;
+	} workers;
+};
+
+// context is allocated on cache line boundary; fields read by other
+// threads are moved to separate lines so that they don't share lines with
+// fields the owner changes on every operation
+struct _thread_ctx_t {
 	thread_list_t header;
 	thread_list_t *prev;
 	reclaimer_t *reclaimer;
-	// reader thread tag and reading flag; whenever thread walking through
-	// the list it tags itself with current tag, increments it and set
-	// the reading flag
-	AO_t is_list_reader;
-	AO_t list_reader_tag;
+	thread_ctx_t *parked_next;
+	// context is either used by a thread or parked for reuse
+	AO_t state;
+	// incremented on entering and leaving ctx_list read-side section hence
+	// it's odd while the thread walks through the list; writers wait for
+	// the counter to change if they observe it odd; waiting writer sets
+	// futex word and sleeps on it until the reader leaves
+	AO_t list_reader_ctr CACHE_ALIGNED;
+	volatile unsigned int list_waiters;
+	// nesting level of read-side sections; callbacks called inside of one
+	// might retire objects and scan
+	size_t list_nesting;
 	
-	rope_t *deleted;
+	rope_t *deleted CACHE_ALIGNED;
+
+	// hazard pages taken from the registry; occupied slots are published
+	// in pages while summaries (bit is set if corresponding word of the
+	// page has a free slot) are private to the owner
+	struct {
+		hazard_page_t **pages;
+		AO_t *summaries;
+		size_t pages_num;
+		size_t capacity;
+		// index of the first page having free slots; equal to pages_num
+		// if all the pages are full
+		size_t free_idx;
+		size_t used;
+	} hazard;
+
+	// scan bookkeeping: reusable hazard set snapshot and occupancy
+	// observed last time; used for choosing scan strategy
+	struct {
+		ptrset_t hazards;
+		size_t hazards_num;
+		size_t threads_num;
+	} scan;
+
+	// node of the thread at the moment it took the context; threads
+	// migrating later keep allocating from that node while the next
+	// thread taking the parked context moves it to its own node
+	int node;
+	// objects found in chunks of other threads by reclaim_help; they are
+	// kept until the hazard snapshot is taken
+	struct {
+		size_t capacity;
+		shadow_ptr_t *candidates;
+	} steal;
 
+	// bytes retired (positive) and reclaimed (negative) by the thread
+	// which aren't published in the budget of the reclaimer yet; workers
+	// never wait for the budget since others wait for them
 	struct {
-		AO_t map;
-		void **hazard_ptrs[ POINTERS_NUMBER ];
-	} hazard
-} thread_ctx_t;
+		long pending;
+		int no_wait;
+	} budget;
+
+	// state of the trigger policy of the reclaimer
+	struct {
+		size_t threshold;
+		uint64_t last_scan;
+	} trigger;
+
+	// magazines of objects allocated or reclaimed by the thread, one per
+	// pool of the reclaimer
+	slab_cache_t *caches;
+
+	// RECLAIM_MODE_EPOCHS state: epoch observed on the last enter (and
+	// activity flag), nesting level of critical sections, epoch of the
+	// current bag; deleted points to bags[ epoch % 3 ]
+	struct {
+		AO_t local CACHE_ALIGNED;
+		size_t nesting CACHE_ALIGNED;
+		AO_t epoch;
+		rope_t *bags[ 3 ];
+	} ebr;
+
+	// RECLAIM_MODE_ERAS state: published interval of eras, nesting level
+	// of critical sections, allocations counter and buffer for intervals
+	// snapshot
+	struct {
+		AO_t lower CACHE_ALIGNED;
+		AO_t upper;
+		size_t nesting CACHE_ALIGNED;
+		size_t allocs;
+		size_t capacity;
+		AO_t *intervals;
+	} eras;
+
+	// written by the owner only and read by reclaim_get_stats
+	struct {
+		AO_t retired CACHE_ALIGNED;
+		AO_t reclaimed;
+		AO_t scans;
+		AO_t clean_local;
+		AO_t clean_all;
+		// decremented by the thread freeing the object which might be
+		// another one so only the sum over threads makes sense
+		AO_t terminated;
+		AO_t stolen;
+		AO_t backlog_peak;
+		AO_t hazards_peak;
+		AO_t scan_hist[ RECLAIM_STATS_BUCKETS ];
+	} stats;
+
+	// retired objects are collected into pending rope and handed over to
+	// the worker as a whole; worker returns emptied ropes back for reuse
+	struct {
+		reclaim_worker_t *worker;
+		rope_t *pending;
+		spsc_t to_worker;
+		spsc_t from_worker;
+	} offload;
+};
 
 extern reclaimer_t *reclaim_init(
 	void ( *terminate )( void *ptr, int is_concurrent ),
 	void ( *clean_up )( void *ptr ),
 	size_t inst_size,
-	size_t inst_align
+	size_t inst_align,
+	int flags
 );
 
-extern thread_ctx_t *reclaim_get_context( reclaimer_t *r );
+// handle of hazard slot: page index of the context times
+// HAZARD_PAGE_SLOTS plus slot index within the page; handles of contexts
+// not in RECLAIM_MODE_HAZARD_POINTERS are always RECLAIM_NO_HAZARD
+typedef size_t reclaim_hazard_t;
+
+#define RECLAIM_NO_HAZARD SIZE_MAX
+
+// reclaim_get_context( r ), reclaim_deref_link( ctx, ptr_to_link ) and
+// functions of hazard handles are inline and defined in reclaim/fastpath.h
+
+// critical section for RECLAIM_MODE_EPOCHS and RECLAIM_MODE_ERAS; calls
+// can be nested; they are no-ops for hazard pointers; in those two modes
+// links may be dereferenced only inside of critical section and pointers
+// stay valid until it's left, code written for hazard pointers must be
+// wrapped into reclaim_enter and reclaim_exit to be used with them
+extern void reclaim_enter( thread_ctx_t *ctx );
+
+extern void reclaim_exit( thread_ctx_t *ctx );
 
-extern void *reclaim_deref_link( thread_ctx_t *ctx, void **ptr_to_link );
+// protects n links at once; dereferenced values are stored into links;
+// if handles isn't NULL then handles of the slots are stored into it
+// (RECLAIM_NO_HAZARD in modes other than hazard pointers) so the batch
+// can be released by reclaim_hazard_release_n without searching for
+// every link among the slots
+extern void reclaim_deref_links( thread_ctx_t *ctx,
+	void * volatile * const *ptrs_to_links,
+	void **links,
+	reclaim_hazard_t *handles,
+	size_t n
+);
 
+// searches the slots of the context for the link; slots taken with
+// reclaim_protect_link are released by handle in O(1)
 extern int reclaim_release_link( thread_ctx_t *ctx, void *link );
 
 extern int reclaim_compare_and_swap_link( thread_ctx_t *ctx,
 	void **where,
-	void *old,
-	void *new
+	void *expected,
+	void *desired
 );
 
 extern void reclaim_store_link( thread_ctx_t *ctx, void **where, void *link );
 
+// returns NULL if the pool of the node has run out of memory
 extern void *reclaim_alloc( thread_ctx_t *ctx );
 
 extern void reclaim_free( thread_ctx_t *ctx, void *what );
 
+// retires n objects with a single check of reclamation threshold
+extern void reclaim_free_n( thread_ctx_t *ctx, void * const *what, size_t n );
+
+// forces reclamation attempt for objects retired by the thread regardless
+// of thresholds
+extern void reclaim_collect( thread_ctx_t *ctx );
+
+// built-in trigger policies; reclaim_policy_count( 0 ) is the default
+
+// objects retired by the thread reach the number; 0 stands for
+// POINTERS_NUMBER per registered thread
+extern reclaim_policy_t reclaim_policy_count( size_t objects );
+// memory held by objects retired by the thread (including ancillary
+// blocks) reaches the budget
+extern reclaim_policy_t reclaim_policy_bytes( size_t bytes );
+// at least us microseconds passed since the last attempt; backlog isn't
+// bounded between attempts
+extern reclaim_policy_t reclaim_policy_time( size_t us );
+// count-based policy whose per-thread threshold starts at objects (0 as
+// for reclaim_policy_count) and is raised after attempts freeing little
+// and lowered after ones freeing most of the list
+extern reclaim_policy_t reclaim_policy_adaptive( size_t objects );
+
+// must be called before any thread takes its context
+extern void reclaim_set_policy( reclaimer_t *r, reclaim_policy_t policy );
+
+// soft limit for memory held by retired objects (including ancillary
+// blocks) of all the threads; 0 removes the limit; threads calling
+// reclaim_free or reclaim_alloc over the limit help to reclaim and then
+// wait for a while; threads with offloading on only wait for workers; can
+// be changed at any moment
+extern void reclaim_set_budget( reclaimer_t *r, size_t bytes );
+// memory held by retired objects which aren't reclaimed yet; every thread
+// might have up to RECLAIM_BUDGET_BATCH bytes unpublished; objects handed
+// over to workers are accounted once workers take them
+extern size_t reclaim_get_unreclaimed_bytes( reclaimer_t *r );
+
+// reclaims objects retired by other threads if RECLAIM_WORK_STEALING is
+// on; meant for threads having nothing else to do; returns number of
+// reclaimed objects
+extern size_t reclaim_help( thread_ctx_t *ctx );
+
+// starts pool of background threads which take over scanning for threads
+// with offloading turned on; returns 0 on failure
+extern int reclaim_workers_start( reclaimer_t *r, size_t workers_num );
+
+// every thread must turn offloading off or finish before the call
+extern void reclaim_workers_stop( reclaimer_t *r );
+
+// when offloading is on, objects retired by the thread are handed over to
+// a worker in batches; the thread never scans nor calls terminate
+extern void reclaim_set_offload( thread_ctx_t *ctx, int is_on );
+
+// parks context of the calling thread for reuse by threads created later;
+// objects which can't be reclaimed right away are adopted by other threads
+// so the call never waits for them; called automatically on thread exit
 extern void reclaim_local_fini( thread_ctx_t *ctx );
 
+// sums up counters of all the threads; can be called from any thread
+// including ones which have no context; values are consistent per counter
+// but not across them
+extern reclaim_stats_t reclaim_get_stats( reclaimer_t *r );
+
 extern void reclaim_fini( reclaimer_t *r );
 
+#include <reclaim/fastpath.h>
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,165 @@
+#ifndef LIBRECLAIM_HPP
+#define LIBRECLAIM_HPP
+
+// RAII layer over the inline fast paths of reclaim.h; guards are bound to
+// the context of the thread which created them and must not cross threads
+
+#include <cstddef>
+#include <utility>
+
+#include <reclaim/reclaim.h>
+
+namespace reclaim {
+
+// critical section for RECLAIM_MODE_EPOCHS and RECLAIM_MODE_ERAS; no-op
+// for hazard pointers
+class critical_section {
+public:
+	explicit critical_section( thread_ctx_t *ctx ) noexcept : ctx_( ctx ) {
+		reclaim_enter( ctx_ );
+	}
+
+	critical_section( const critical_section& ) = delete;
+	critical_section &operator=( const critical_section& ) = delete;
+
+	~critical_section() {
+		reclaim_exit( ctx_ );
+	}
+
+private:
+	thread_ctx_t *ctx_;
+};
+
+// owns one hazard slot from the first protect till reset or destruction;
+// protecting another link reuses the slot so traversals don't acquire
+// slots in their loops
+template< typename T >
+class hazard_guard {
+public:
+	hazard_guard() noexcept : ctx_( nullptr ), hazard_( RECLAIM_NO_HAZARD ) {}
+
+	explicit hazard_guard( thread_ctx_t *ctx ) noexcept :
+		ctx_( ctx ),
+		hazard_( RECLAIM_NO_HAZARD )
+	{}
+
+	hazard_guard( const hazard_guard& ) = delete;
+	hazard_guard &operator=( const hazard_guard& ) = delete;
+
+	hazard_guard( hazard_guard &&other ) noexcept :
+		ctx_( other.ctx_ ),
+		hazard_( other.hazard_ )
+	{
+		other.hazard_ = RECLAIM_NO_HAZARD;
+	}
+
+	hazard_guard &operator=( hazard_guard &&other ) noexcept {
+		if( this != &other ) {
+			reset();
+			ctx_ = other.ctx_;
+			hazard_ = other.hazard_;
+			other.hazard_ = RECLAIM_NO_HAZARD;
+		}
+
+		return *this;
+	}
+
+	~hazard_guard() {
+		reset();
+	}
+
+	// returned value is the link as is, with tags
+	T *protect( T * volatile *where ) noexcept {
+		return static_cast< T* >( reclaim_protect_link( ctx_,
+			reinterpret_cast< void * volatile * >( where ),
+			&hazard_
+		) );
+	}
+
+	void reset() noexcept {
+		reclaim_hazard_release( ctx_, hazard_ );
+		hazard_ = RECLAIM_NO_HAZARD;
+	}
+
+	thread_ctx_t *context() const noexcept {
+		return ctx_;
+	}
+
+private:
+	thread_ctx_t *ctx_;
+	reclaim_hazard_t hazard_;
+};
+
+// pointer loaded from a link which stays protected while the object is
+// alive; tags of the link are kept in link() and stripped by get()
+template< typename T >
+class protected_ptr {
+public:
+	protected_ptr() noexcept : link_( nullptr ) {}
+
+	explicit protected_ptr( thread_ctx_t *ctx ) noexcept :
+		guard_( ctx ),
+		link_( nullptr )
+	{}
+
+	protected_ptr( thread_ctx_t *ctx, T * volatile *where ) noexcept :
+		guard_( ctx ),
+		link_( guard_.protect( where ) )
+	{}
+
+	protected_ptr( protected_ptr &&other ) noexcept :
+		guard_( std::move( other.guard_ ) ),
+		link_( other.link_ )
+	{
+		other.link_ = nullptr;
+	}
+
+	protected_ptr &operator=( protected_ptr &&other ) noexcept {
+		if( this != &other ) {
+			guard_ = std::move( other.guard_ );
+			link_ = other.link_;
+			other.link_ = nullptr;
+		}
+
+		return *this;
+	}
+
+	// moves protection to the object the link points to at the moment
+	T *protect( T * volatile *where ) noexcept {
+		link_ = guard_.protect( where );
+		return get();
+	}
+
+	void reset() noexcept {
+		guard_.reset();
+		link_ = nullptr;
+	}
+
+	T *link() const noexcept {
+		return link_;
+	}
+
+	T *get() const noexcept {
+		return static_cast< T* >( RECLAIM_LINK_STRIP( link_ ) );
+	}
+
+	T *operator->() const noexcept {
+		return get();
+	}
+
+	T &operator*() const noexcept {
+		return *get();
+	}
+
+	explicit operator bool() const noexcept {
+		return get() != nullptr;
+	}
+
+private:
+	hazard_guard< T > guard_;
+	T *link_;
+};
+
+}
+
+#endif
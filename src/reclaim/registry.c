@@ -0,0 +1,165 @@
+#include <reclaim/registry.h>
+#include <reclaim_config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+void registry_init( hazard_registry_t *reg ) {
+	assert( reg != NULL );
+
+	pthread_mutex_init( &( reg->guard ), NULL );
+
+	hazard_dir_t *dir = malloc( sizeof( hazard_dir_t ) );
+	dir->retired_next = NULL;
+	dir->segments_num = 0;
+
+	reg->dir = ( AO_t ) dir;
+	reg->pages_num = 0;
+	reg->retired = NULL;
+	memset( reg->nodes, 0, sizeof( reg->nodes ) );
+
+	AO_nop_full();
+}
+
+#define SEGMENT_SIZE ( sizeof( hazard_page_t ) * HAZARD_SEGMENT_PAGES )
+
+// memory of the segment is zeroed hence all of its pages are empty;
+// returns 0 if the segment can't be mapped
+static int _registry_grow( hazard_registry_t *reg, int node ) {
+	hazard_dir_t *old_dir = ( hazard_dir_t* ) reg->dir;
+	void *segment = numa_alloc_onnode( SEGMENT_SIZE, CACHE_LINE_SIZE, node );
+
+	if( segment == NULL )
+		return 0;
+
+	hazard_dir_t *dir = malloc( sizeof( hazard_dir_t ) +
+		sizeof( hazard_page_t* ) * ( old_dir->segments_num + 1 )
+	);
+	dir->retired_next = NULL;
+	dir->segments_num = old_dir->segments_num + 1;
+	memcpy( dir->segments,
+		old_dir->segments,
+		sizeof( hazard_page_t* ) * old_dir->segments_num
+	);
+	dir->segments[ old_dir->segments_num ] = segment;
+
+	// directory must be filled before it's visible to scanners
+	AO_nop_full();
+	AO_store( &( reg->dir ), ( AO_t ) dir );
+
+	old_dir->retired_next = reg->retired;
+	reg->retired = old_dir;
+
+	reg->nodes[ node ].fresh_idx = old_dir->segments_num * HAZARD_SEGMENT_PAGES;
+	reg->nodes[ node ].fresh_end = reg->nodes[ node ].fresh_idx +
+		HAZARD_SEGMENT_PAGES;
+
+	AO_nop_full();
+	AO_store( &( reg->pages_num ), reg->nodes[ node ].fresh_end );
+
+	return 1;
+}
+
+inline static int _registry_node( int node ) {
+	return ( ( node < 0 ) || ( node >= NUMA_MAX_NODES ) ) ? 0 : node;
+}
+
+hazard_page_t *registry_page_get( hazard_registry_t *reg, int node ) {
+	assert( reg != NULL );
+
+	hazard_node_t *n = &( reg->nodes[ node = _registry_node( node ) ] );
+	hazard_page_t *page;
+
+	pthread_mutex_lock( &( reg->guard ) );
+
+	if( n->free_num > 0 )
+		page = n->free[ --( n->free_num ) ];
+	else if( ( n->fresh_idx == n->fresh_end ) && ! _registry_grow( reg, node ) )
+		page = NULL;
+	else {
+		size_t idx = n->fresh_idx++;
+
+		page = ( ( hazard_dir_t* ) reg->dir )->segments[
+			idx / HAZARD_SEGMENT_PAGES
+		] + ( idx % HAZARD_SEGMENT_PAGES );
+	}
+
+	pthread_mutex_unlock( &( reg->guard ) );
+
+	return page;
+}
+
+void registry_page_put( hazard_registry_t *reg,
+	hazard_page_t *page,
+	int node
+) {
+	assert( reg != NULL );
+	assert( page != NULL );
+
+	hazard_node_t *n = &( reg->nodes[ _registry_node( node ) ] );
+
+	for( int w = 0; w < HAZARD_PAGE_WORDS; ++w ) {
+		for( AO_t occupied = page->occupied[ w ];
+			occupied != 0;
+			occupied &= occupied - 1
+		)
+			AO_store(
+				( AO_t* ) &( page->ptrs[ w * POINTERS_NUMBER +
+					ffsl( occupied ) - 1 ] ),
+				( AO_t ) NULL
+			);
+
+		AO_store( &( page->occupied[ w ] ), 0 );
+	}
+
+	pthread_mutex_lock( &( reg->guard ) );
+
+	if( n->free_num == n->free_capacity ) {
+		n->free_capacity = ( n->free_capacity == 0 ) ?
+			HAZARD_SEGMENT_PAGES :
+			n->free_capacity * 2;
+		n->free = realloc( n->free,
+			sizeof( hazard_page_t* ) * n->free_capacity
+		);
+	}
+
+	n->free[ n->free_num++ ] = page;
+
+	pthread_mutex_unlock( &( reg->guard ) );
+}
+
+hazard_dir_t *registry_detach_retired( hazard_registry_t *reg ) {
+	assert( reg != NULL );
+
+	pthread_mutex_lock( &( reg->guard ) );
+	hazard_dir_t *dirs = reg->retired;
+	reg->retired = NULL;
+	pthread_mutex_unlock( &( reg->guard ) );
+
+	return dirs;
+}
+
+void registry_free_dirs( hazard_dir_t *dirs ) {
+	for( hazard_dir_t *next; dirs != NULL; dirs = next ) {
+		next = dirs->retired_next;
+		free( dirs );
+	}
+}
+
+void registry_destroy( hazard_registry_t *reg ) {
+	assert( reg != NULL );
+
+	hazard_dir_t *dir = ( hazard_dir_t* ) reg->dir;
+
+	for( size_t i = 0; i < dir->segments_num; ++i )
+		numa_free( dir->segments[ i ], SEGMENT_SIZE );
+
+	registry_free_dirs( reg->retired );
+	free( dir );
+
+	for( int node = 0; node < NUMA_MAX_NODES; ++node )
+		free( reg->nodes[ node ].free );
+
+	pthread_mutex_destroy( &( reg->guard ) );
+}
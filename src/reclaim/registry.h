@@ -0,0 +1,150 @@
+#ifndef LIBRECLAIM_REGISTRY
+#define LIBRECLAIM_REGISTRY
+
+#include <stddef.h>
+#include <strings.h>
+#include <pthread.h>
+#include <atomic_ops.h>
+
+#include <utils/cacheline.h>
+#include <utils/numa.h>
+
+#define POINTERS_NUMBER ( sizeof( AO_t ) * 8 )
+
+// number of bitmap words per hazard page; every word covers
+// POINTERS_NUMBER slots
+#ifndef HAZARD_PAGE_WORDS
+	#define HAZARD_PAGE_WORDS 4
+#endif
+
+#define HAZARD_PAGE_SLOTS ( HAZARD_PAGE_WORDS * POINTERS_NUMBER )
+
+// number of pages allocated by registry at once
+#ifndef HAZARD_SEGMENT_PAGES
+	#define HAZARD_SEGMENT_PAGES 64
+#endif
+
+// hazard slots published by a thread; page holds only what scanners read:
+// mask of occupied slots and slots themselves; owner-only bookkeeping is
+// kept in thread context
+typedef struct {
+	AO_t occupied[ HAZARD_PAGE_WORDS ];
+	void *ptrs[ HAZARD_PAGE_SLOTS ];
+} CACHE_ALIGNED hazard_page_t;
+
+// directory of segments; every segment is contiguous array of
+// HAZARD_SEGMENT_PAGES pages; directory is replaced on growth while
+// segments stay in place, replaced directory is freed after grace period
+// of ctx_list RCU
+typedef struct _hazard_dir_t {
+	struct _hazard_dir_t *retired_next;
+	size_t segments_num;
+	hazard_page_t *segments[];
+} hazard_dir_t;
+
+// pages placed on one NUMA node: released ones and the unused tail of
+// the last segment allocated there
+typedef struct {
+	size_t free_num;
+	size_t free_capacity;
+	hazard_page_t **free;
+	size_t fresh_idx;
+	size_t fresh_end;
+} hazard_node_t;
+
+// hazard pages of all the threads; scanners stream through segments
+// linearly instead of chasing thread contexts; every segment is placed on
+// one node and its pages are handed out to threads running there only
+// so slots written on every acquisition stay node-local
+typedef struct {
+	pthread_mutex_t guard;
+	// pages number is published after the directory covering it; pages
+	// of a segment which aren't handed out yet are empty so scanners walk
+	// whole segments
+	AO_t dir;
+	AO_t pages_num;
+	hazard_dir_t *retired;
+	hazard_node_t nodes[ NUMA_MAX_NODES ];
+} hazard_registry_t;
+
+typedef struct {
+	hazard_dir_t *dir;
+	size_t pages_num;
+	size_t idx;
+	int word;
+	AO_t occupied;
+	hazard_page_t *page;
+} hazard_iter_t;
+
+extern void registry_init( hazard_registry_t *reg );
+// returned page has no occupied slots and is placed on the node; NULL is
+// returned if a new segment is needed and can't be mapped
+extern hazard_page_t *registry_page_get( hazard_registry_t *reg, int node );
+// slots which are still occupied are released; node must be the one page
+// was taken for
+extern void registry_page_put( hazard_registry_t *reg,
+	hazard_page_t *page,
+	int node
+);
+// detaches directories replaced so far; they can be freed with
+// registry_free_dirs when grace period is over
+extern hazard_dir_t *registry_detach_retired( hazard_registry_t *reg );
+// hint read without the lock
+inline static int registry_has_retired( hazard_registry_t *reg ) {
+	return AO_load( ( AO_t* ) &( reg->retired ) ) != 0;
+}
+extern void registry_free_dirs( hazard_dir_t *dirs );
+extern void registry_destroy( hazard_registry_t *reg );
+
+// caller must be ctx_list RCU reader
+inline static void registry_iter_init( hazard_iter_t *iter,
+	hazard_registry_t *reg
+) {
+	iter->pages_num = AO_load( &( reg->pages_num ) );
+	AO_nop_full();
+	iter->dir = ( hazard_dir_t* ) AO_load( &( reg->dir ) );
+	iter->idx = 0;
+	iter->word = 0;
+	iter->page = ( iter->pages_num > 0 ) ? iter->dir->segments[ 0 ] : NULL;
+	iter->occupied = ( iter->page != NULL ) ?
+		AO_load( &( iter->page->occupied[ 0 ] ) ) :
+		0;
+}
+
+// returns next published hazard pointer or NULL when registry is over
+inline static void *registry_iter_next( hazard_iter_t *iter ) {
+	void *ptr;
+
+	while( iter->page != NULL ) {
+		while( iter->occupied != 0 ) {
+			int b = ffsl( iter->occupied ) - 1;
+			iter->occupied &= iter->occupied - 1;
+
+			ptr = ( void* ) AO_load( ( AO_t* ) &(
+				iter->page->ptrs[ iter->word * POINTERS_NUMBER + b ]
+			) );
+
+			if( ptr != NULL )
+				return ptr;
+		}
+
+		if( ++( iter->word ) == HAZARD_PAGE_WORDS ) {
+			iter->word = 0;
+
+			if( ++( iter->idx ) == iter->pages_num ) {
+				iter->page = NULL;
+				return NULL;
+			}
+
+			iter->page = iter->dir->segments[
+				iter->idx / HAZARD_SEGMENT_PAGES
+			] + ( iter->idx % HAZARD_SEGMENT_PAGES );
+		}
+
+		iter->occupied = AO_load( &( iter->page->occupied[ iter->word ] ) );
+	}
+
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,269 @@
+#include <reclaim/workers.h>
+#include <reclaim_config.h>
+
+#include <stdlib.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+#include <utils/rope.h>
+#include <utils/spsc.h>
+#include <reclaim/internal.h>
+
+// size of the pending rope which is handed over to the worker
+#ifndef RECLAIM_OFFLOAD_BATCH
+	#define RECLAIM_OFFLOAD_BATCH ( POINTERS_NUMBER * 4 )
+#endif
+
+// number of ropes which can be in flight between thread and its worker
+#ifndef RECLAIM_OFFLOAD_QUEUE
+	#define RECLAIM_OFFLOAD_QUEUE 16
+#endif
+
+static struct timespec _idle_timeout = {
+	.tv_sec = 0,
+	.tv_nsec = 50000
+};
+
+// moves objects from the rope to deletion list of ctx; ropes in flight
+// are never reachable through ctx_list so nobody else can hold claims
+// on them
+static void _drain_rope( thread_ctx_t *ctx, rope_t *rope ) {
+	void *batch[ POINTERS_NUMBER ];
+	size_t n = 0;
+	rope_ptr_t iter;
+
+	for( int cont = rope_iterator_create( rope, &iter );
+		cont;
+		cont = rope_iterator_next( &iter )
+	) {
+		batch[ n++ ] = rope_owner_iterator_deref( &iter );
+		rope_owner_delete( rope, &iter );
+
+		if( n == POINTERS_NUMBER ) {
+			reclaim_free_n( ctx, batch, n );
+			n = 0;
+		}
+	}
+
+	if( n > 0 )
+		reclaim_free_n( ctx, batch, n );
+
+	// rope goes back to the thread empty; memory grown by the burst
+	// is returned right away since nobody else walks through it
+	if( rope_owner_shrink( rope ) )
+		rope_owner_free_retired( rope );
+}
+
+// queues of ctx are valid only while it's assigned to the worker; it
+// might have been detached (and even attached again) while the rope was
+// drained
+static int _worker_give_back( reclaim_worker_t *w,
+	thread_ctx_t *ctx,
+	rope_t *rope
+) {
+	int is_given = 0;
+
+	pthread_mutex_lock( &( w->guard ) );
+
+	for( size_t i = 0; i < w->ctxs_num; ++i )
+		if( w->ctxs[ i ] == ctx ) {
+			is_given = spsc_push( &( ctx->offload.from_worker ), rope );
+			break;
+		}
+
+	pthread_mutex_unlock( &( w->guard ) );
+
+	return is_given;
+}
+
+// the lock is held only while queues are touched; ropes are drained with
+// the lock released so threads attaching and detaching never wait for
+// scans and callbacks; assignments changed meanwhile might make the
+// worker skip a thread till the next poll
+static int _worker_poll( reclaim_worker_t *w, thread_ctx_t *wctx ) {
+	int did_work = 0;
+	thread_ctx_t *ctx = NULL;
+	rope_t *rope;
+
+	for( size_t i = 0; ; ) {
+		pthread_mutex_lock( &( w->guard ) );
+
+		for( rope = NULL; ( rope == NULL ) && ( i < w->ctxs_num ); )
+			if( ( rope = spsc_pop( &( w->ctxs[ i ]->offload.to_worker ) ) ) != NULL )
+				ctx = w->ctxs[ i ];
+			else
+				++i;
+
+		pthread_mutex_unlock( &( w->guard ) );
+
+		if( rope == NULL )
+			return did_work;
+
+		_drain_rope( wctx, rope );
+		did_work = 1;
+
+		if( ! _worker_give_back( w, ctx, rope ) )
+			rope_destroy( rope );
+	}
+}
+
+static void *_worker_main( void *arg ) {
+	reclaim_worker_t *w = arg;
+	reclaimer_t *r = w->reclaimer;
+	thread_ctx_t *wctx = reclaim_get_context( r );
+
+	wctx->budget.no_wait = 1;
+
+	while( AO_load( &( r->workers.is_running ) ) )
+		if( ! _worker_poll( w, wctx ) ) {
+			// backlog of the worker might be under the threshold for long
+			if( wctx->deleted->ptrs_number > 0 )
+				reclaim_collect( wctx );
+
+			// idle worker reclaims for threads scanning by themselves
+			if( reclaim_help( wctx ) == 0 )
+				nanosleep( &_idle_timeout, NULL );
+		}
+
+	_worker_poll( w, wctx );
+
+	return NULL;
+}
+
+int reclaim_workers_start( reclaimer_t *r, size_t workers_num ) {
+	assert( r != NULL );
+	assert( workers_num > 0 );
+	assert( r->workers.num == 0 );
+
+	r->workers.array = malloc( sizeof( reclaim_worker_t ) * workers_num );
+	r->workers.next = 0;
+	AO_store( &( r->workers.is_running ), 1 );
+
+	for( size_t i = 0; i < workers_num; ++i ) {
+		reclaim_worker_t *w = &( r->workers.array[ i ] );
+
+		w->reclaimer = r;
+		w->ctxs_num = 0;
+		w->capacity = 0;
+		w->ctxs = NULL;
+		pthread_mutex_init( &( w->guard ), NULL );
+
+		if( pthread_create( &( w->thread ), NULL, _worker_main, w ) ) {
+			pthread_mutex_destroy( &( w->guard ) );
+			r->workers.num = i;
+			reclaim_workers_stop( r );
+			return 0;
+		}
+	}
+
+	AO_nop_full();
+	r->workers.num = workers_num;
+
+	return 1;
+}
+
+void reclaim_workers_stop( reclaimer_t *r ) {
+	assert( r != NULL );
+
+	AO_store( &( r->workers.is_running ), 0 );
+	AO_nop_full();
+
+	for( size_t i = 0; i < r->workers.num; ++i ) {
+		reclaim_worker_t *w = &( r->workers.array[ i ] );
+
+		pthread_join( w->thread, NULL );
+		pthread_mutex_destroy( &( w->guard ) );
+		free( w->ctxs );
+	}
+
+	free( r->workers.array );
+	r->workers.array = NULL;
+	r->workers.num = 0;
+}
+
+void reclaim_set_offload( thread_ctx_t *ctx, int is_on ) {
+	assert( ctx != NULL );
+
+	if( ! is_on ) {
+		if( ctx->offload.worker != NULL )
+			workers_detach( ctx );
+
+		return;
+	}
+
+	reclaimer_t *r = ctx->reclaimer;
+
+	if( ( ctx->offload.worker != NULL ) || ( r->workers.num == 0 ) )
+		return;
+
+	reclaim_worker_t *w = &( r->workers.array[
+		AO_fetch_and_add_full( &( r->workers.next ), 1 ) % r->workers.num
+	] );
+
+	spsc_init( &( ctx->offload.to_worker ), RECLAIM_OFFLOAD_QUEUE );
+	spsc_init( &( ctx->offload.from_worker ), RECLAIM_OFFLOAD_QUEUE );
+	ctx->offload.pending = rope_create();
+
+	pthread_mutex_lock( &( w->guard ) );
+
+	if( w->ctxs_num == w->capacity ) {
+		w->capacity = ( w->capacity == 0 ) ? 8 : w->capacity * 2;
+		w->ctxs = realloc( w->ctxs, sizeof( thread_ctx_t* ) * w->capacity );
+	}
+
+	w->ctxs[ w->ctxs_num++ ] = ctx;
+
+	pthread_mutex_unlock( &( w->guard ) );
+
+	ctx->offload.worker = w;
+}
+
+void workers_offload( thread_ctx_t *ctx, void * const *what, size_t n ) {
+	rope_owner_put_n( ctx->offload.pending, what, n );
+
+	// if queue is full pending rope keeps growing until worker catches up
+	if( ( ctx->offload.pending->ptrs_number >= RECLAIM_OFFLOAD_BATCH ) &&
+		spsc_push( &( ctx->offload.to_worker ), ctx->offload.pending )
+	) {
+		ctx->offload.pending = spsc_pop( &( ctx->offload.from_worker ) );
+
+		if( ctx->offload.pending == NULL )
+			ctx->offload.pending = rope_create();
+	}
+}
+
+void workers_detach( thread_ctx_t *ctx ) {
+	reclaim_worker_t *w = ctx->offload.worker;
+	rope_t *rope;
+
+	assert( w != NULL );
+
+	pthread_mutex_lock( &( w->guard ) );
+
+	for( size_t i = 0; i < w->ctxs_num; ++i )
+		if( w->ctxs[ i ] == ctx ) {
+			w->ctxs[ i ] = w->ctxs[ --( w->ctxs_num ) ];
+			break;
+		}
+
+	pthread_mutex_unlock( &( w->guard ) );
+
+	// worker can't touch queues anymore; ropes it has already taken are
+	// drained by it and destroyed
+	ctx->offload.worker = NULL;
+
+	while( ( rope = spsc_pop( &( ctx->offload.to_worker ) ) ) != NULL ) {
+		_drain_rope( ctx, rope );
+		rope_destroy( rope );
+	}
+
+	_drain_rope( ctx, ctx->offload.pending );
+	rope_destroy( ctx->offload.pending );
+	ctx->offload.pending = NULL;
+
+	while( ( rope = spsc_pop( &( ctx->offload.from_worker ) ) ) != NULL )
+		rope_destroy( rope );
+
+	spsc_destroy( &( ctx->offload.to_worker ) );
+	spsc_destroy( &( ctx->offload.from_worker ) );
+}
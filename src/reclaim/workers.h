@@ -0,0 +1,15 @@
+#ifndef LIBRECLAIM_WORKERS
+#define LIBRECLAIM_WORKERS
+
+// background reclamation threads; not a part of public API
+
+#include <reclaim/reclaim.h>
+
+// puts objects into the pending rope of the thread and hands it over to
+// the worker once it's big enough
+extern void workers_offload( thread_ctx_t *ctx, void * const *what, size_t n );
+// unassigns thread from its worker; objects which haven't been taken by
+// the worker yet are retired by the thread itself
+extern void workers_detach( thread_ctx_t *ctx );
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef LIBBITMAP
+#define LIBBITMAP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic_ops.h>
+
+#if defined( __AVX2__ )
+	#include <immintrin.h>
+#endif
+
+// search in flat bitmaps of AO_t words; bitmaps changed by another thread
+// are seen as of some recent moment; words whose bits are returned are
+// loaded with acquire to pair with the release store of the writer so
+// data published before the bit is seen along with it
+
+#define BITMAP_WORD_BITS ( sizeof( AO_t ) * 8 )
+#define BITMAP_BIT_MASK ( BITMAP_WORD_BITS - 1 )
+
+// returns index of the first word starting from widx which has a bit
+// different from the corresponding bit of flip (0 or ~0); words_num if
+// there is no such word; whole words are skipped four at a time
+inline static size_t _bitmap_skip( const AO_t *words,
+	size_t words_num,
+	size_t widx,
+	AO_t flip
+) {
+	#if defined( __AVX2__ )
+		const __m256i ones = _mm256_set1_epi64x( -1 );
+
+		for( ; ( widx + 4 ) <= words_num; widx += 4 ) {
+			__m256i block = _mm256_loadu_si256(
+				( const __m256i* ) &( words[ widx ] )
+			);
+
+			if( flip ?
+				! _mm256_testc_si256( block, ones ) :
+				! _mm256_testz_si256( block, block )
+			)
+				break;
+		}
+	#else
+		for( ; ( widx + 4 ) <= words_num; widx += 4 )
+			if( flip ?
+				( ( words[ widx ] & words[ widx + 1 ] &
+					words[ widx + 2 ] & words[ widx + 3 ] ) != flip ) :
+				( ( words[ widx ] | words[ widx + 1 ] |
+					words[ widx + 2 ] | words[ widx + 3 ] ) != 0 )
+			)
+				break;
+	#endif
+
+	for( ; widx < words_num; ++widx )
+		if( AO_load( &( words[ widx ] ) ) != flip )
+			return widx;
+
+	return words_num;
+}
+
+inline static size_t _bitmap_find( const AO_t *words,
+	size_t words_num,
+	size_t from,
+	AO_t flip
+) {
+	size_t widx = from / BITMAP_WORD_BITS;
+
+	if( widx >= words_num )
+		return SIZE_MAX;
+
+	AO_t word = ( AO_load_acquire( &( words[ widx ] ) ) ^ flip ) &
+		( ( ~ ( AO_t ) 0 ) << ( from & BITMAP_BIT_MASK ) );
+
+	if( word == 0 ) {
+		widx = _bitmap_skip( words, words_num, widx + 1, flip );
+
+		if( widx == words_num )
+			return SIZE_MAX;
+
+		word = AO_load_acquire( &( words[ widx ] ) ) ^ flip;
+	}
+
+	return widx * BITMAP_WORD_BITS + __builtin_ctzl( word );
+}
+
+// index of the first set bit at or after from; SIZE_MAX if there is none
+inline static size_t bitmap_find_set( const AO_t *words,
+	size_t words_num,
+	size_t from
+) {
+	return _bitmap_find( words, words_num, from, 0 );
+}
+
+// index of the first clear bit at or after from; SIZE_MAX if there is none
+inline static size_t bitmap_find_clear( const AO_t *words,
+	size_t words_num,
+	size_t from
+) {
+	return _bitmap_find( words, words_num, from, ~ ( AO_t ) 0 );
+}
+
+// number of consecutive set bits starting from from
+inline static size_t bitmap_run_length( const AO_t *words,
+	size_t words_num,
+	size_t from
+) {
+	size_t widx = from / BITMAP_WORD_BITS;
+	size_t bit = from & BITMAP_BIT_MASK;
+	size_t len = 0, n;
+	AO_t word;
+
+	for( ; widx < words_num; ++widx, bit = 0 ) {
+		// bits shifted in from above are zeros so the run can't go past
+		// the end of the word here
+		word = ~ ( AO_load_acquire( &( words[ widx ] ) ) >> bit );
+
+		if( word != 0 ) {
+			n = __builtin_ctzl( word );
+
+			if( n < ( BITMAP_WORD_BITS - bit ) )
+				return len + n;
+		}
+
+		len += BITMAP_WORD_BITS - bit;
+	}
+
+	return len;
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef LIBCACHELINE
+#define LIBCACHELINE
+
+#ifndef CACHE_LINE_SIZE
+	#define CACHE_LINE_SIZE 64
+#endif
+
+// placed on a field, starts new cache line with it; placed on a type,
+// makes every instance occupy whole cache lines
+#define CACHE_ALIGNED __attribute__(( aligned( CACHE_LINE_SIZE ) ))
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef LIBFUTEX
+#define LIBFUTEX
+
+#include <time.h>
+#include <sched.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#if defined( __NR_futex )
+	#include <linux/futex.h>
+#endif
+
+// number of polls made before the waiter goes to sleep
+#ifndef FUTEX_SPIN_ITERATIONS
+	#define FUTEX_SPIN_ITERATIONS 256
+#endif
+
+inline static void cpu_relax( void ) {
+	#if defined( __i386__ ) || defined( __x86_64__ )
+		__builtin_ia32_pause();
+	#elif defined( __aarch64__ )
+		__asm__ __volatile__( "yield" ::: "memory" );
+	#else
+		__asm__ __volatile__( "" ::: "memory" );
+	#endif
+}
+
+// sleeps while *addr is equal to val; spurious wake-ups are possible so
+// caller has to check its condition again
+inline static void futex_wait( volatile unsigned int *addr, unsigned int val ) {
+	#if defined( __NR_futex )
+		syscall( __NR_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0 );
+	#else
+		static const struct timespec timeout = {
+			.tv_sec = 0,
+			.tv_nsec = 400
+		};
+
+		if( *addr == val )
+			nanosleep( &timeout, NULL );
+	#endif
+}
+
+// like futex_wait but sleeps no longer than timeout
+inline static void futex_wait_timeout( volatile unsigned int *addr,
+	unsigned int val,
+	const struct timespec *timeout
+) {
+	#if defined( __NR_futex )
+		syscall( __NR_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout, NULL, 0 );
+	#else
+		if( *addr == val )
+			nanosleep( timeout, NULL );
+	#endif
+}
+
+inline static void futex_wake_all( volatile unsigned int *addr ) {
+	#if defined( __NR_futex )
+		syscall( __NR_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0 );
+	#endif
+}
+
+#endif
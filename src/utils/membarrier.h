@@ -0,0 +1,37 @@
+#ifndef LIBMEMBARRIER
+#define LIBMEMBARRIER
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#if defined( __NR_membarrier )
+	#include <linux/membarrier.h>
+#endif
+
+// registers process for private expedited membarrier(2); returns 0 if
+// kernel doesn't support it
+inline static int membarrier_register( void ) {
+	#if defined( __NR_membarrier )
+		long cmds = syscall( __NR_membarrier, MEMBARRIER_CMD_QUERY, 0 );
+
+		if( ( cmds < 0 ) || ! ( cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED ) )
+			return 0;
+
+		return syscall( __NR_membarrier,
+			MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED,
+			0
+		) == 0;
+	#else
+		return 0;
+	#endif
+}
+
+// issues full memory barrier on every running thread of the process;
+// must be called only after successful membarrier_register
+inline static void membarrier_heavy( void ) {
+	#if defined( __NR_membarrier )
+		syscall( __NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0 );
+	#endif
+}
+
+#endif
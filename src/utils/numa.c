@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+
+#include <utils/numa.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <reclaim_config.h>
+
+#ifndef MPOL_PREFERRED
+	#define MPOL_PREFERRED 1
+#endif
+
+#define NUMA_SYSFS_NODES "/sys/devices/system/node"
+
+static struct {
+	size_t nodes_num;
+	int is_fake;
+	size_t cpus_num;
+	int *cpu_nodes;
+} _topology;
+
+static pthread_once_t _topology_once = PTHREAD_ONCE_INIT;
+
+// calls fn for every number of the list like "0-3,8,10-11" read from
+// the file; returns 0 if the file can't be read
+static int _read_list( const char *path,
+	void ( *fn )( size_t n, void *arg ),
+	void *arg
+) {
+	char buf[ 4096 ];
+	FILE *f = fopen( path, "r" );
+
+	if( f == NULL )
+		return 0;
+
+	size_t len = fread( buf, 1, sizeof( buf ) - 1, f );
+	fclose( f );
+	buf[ len ] = '\0';
+
+	for( char *cur = buf, *end; ( *cur != '\0' ) && ( *cur != '\n' ); ) {
+		size_t lo = strtoul( cur, &end, 10 ), hi = lo;
+
+		if( end == cur )
+			break;
+
+		if( *end == '-' ) {
+			cur = end + 1;
+			hi = strtoul( cur, &end, 10 );
+		}
+
+		for( size_t n = lo; n <= hi; ++n )
+			fn( n, arg );
+
+		cur = ( *end == ',' ) ? ( end + 1 ) : end;
+	}
+
+	return 1;
+}
+
+static void _node_seen( size_t n, void *arg ) {
+	( void ) arg;
+
+	if( ( n < NUMA_MAX_NODES ) && ( n >= _topology.nodes_num ) )
+		_topology.nodes_num = n + 1;
+}
+
+static void _cpu_seen( size_t n, void *arg ) {
+	if( n < _topology.cpus_num )
+		_topology.cpu_nodes[ n ] = ( int ) ( intptr_t ) arg;
+}
+
+static void _topology_discover( void ) {
+	long cpus = sysconf( _SC_NPROCESSORS_CONF );
+	const char *fake = getenv( NUMA_FAKE_ENV );
+	long fake_num = ( fake != NULL ) ? atol( fake ) : 0;
+	char path[ 128 ];
+
+	_topology.cpus_num = ( cpus > 0 ) ? ( size_t ) cpus : 1;
+	_topology.cpu_nodes = calloc( _topology.cpus_num, sizeof( int ) );
+	_topology.nodes_num = 0;
+	_topology.is_fake = ( fake_num > 0 );
+
+	if( _topology.is_fake ) {
+		_topology.nodes_num = ( fake_num > NUMA_MAX_NODES ) ?
+			NUMA_MAX_NODES :
+			( size_t ) fake_num;
+
+		for( size_t cpu = 0; cpu < _topology.cpus_num; ++cpu )
+			_topology.cpu_nodes[ cpu ] = cpu % _topology.nodes_num;
+
+		return;
+	}
+
+	if( ! _read_list( NUMA_SYSFS_NODES "/online", _node_seen, NULL ) ||
+		( _topology.nodes_num == 0 )
+	) {
+		_topology.nodes_num = 1;
+		return;
+	}
+
+	for( size_t node = 0; node < _topology.nodes_num; ++node ) {
+		snprintf( path, sizeof( path ),
+			NUMA_SYSFS_NODES "/node%zu/cpulist",
+			node
+		);
+		_read_list( path, _cpu_seen, ( void* ) ( intptr_t ) node );
+	}
+}
+
+size_t numa_nodes_num( void ) {
+	pthread_once( &_topology_once, _topology_discover );
+
+	return _topology.nodes_num;
+}
+
+int numa_current_node( void ) {
+	pthread_once( &_topology_once, _topology_discover );
+
+	int cpu = sched_getcpu();
+
+	if( ( cpu < 0 ) || ( ( size_t ) cpu >= _topology.cpus_num ) )
+		return 0;
+
+	return _topology.cpu_nodes[ cpu ];
+}
+
+// placement is a preference; kernel falls back to other nodes instead of
+// failing when the node is short of memory
+static void _bind( void *mem, size_t size, int node ) {
+	#if defined( __NR_mbind )
+		unsigned long mask[ ( NUMA_MAX_NODES + 63 ) / 64 ] = { 0 };
+
+		if( _topology.is_fake ||
+			( _topology.nodes_num < 2 ) ||
+			( node < 0 ) ||
+			( ( size_t ) node >= _topology.nodes_num )
+		)
+			return;
+
+		mask[ node / 64 ] = 1ul << ( node % 64 );
+		syscall( __NR_mbind, mem, size, MPOL_PREFERRED, mask,
+			NUMA_MAX_NODES + 1,
+			0
+		);
+	#else
+		( void ) mem;
+		( void ) size;
+		( void ) node;
+	#endif
+}
+
+inline static size_t _page_size( void ) {
+	long page = sysconf( _SC_PAGESIZE );
+
+	return ( page > 0 ) ? ( size_t ) page : 4096;
+}
+
+// mapping is made bigger by alignment and its head and tail are unmapped
+void *numa_alloc_onnode( size_t size, size_t align, int node ) {
+	pthread_once( &_topology_once, _topology_discover );
+
+	size_t page = _page_size();
+
+	size = ( size + page - 1 ) & ~ ( page - 1 );
+	if( align < page )
+		align = page;
+
+	size_t map_sz = size + align - page;
+	char *mem = mmap( NULL,
+		map_sz,
+		PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS,
+		-1,
+		0
+	);
+
+	if( mem == MAP_FAILED )
+		return NULL;
+
+	char *aligned = ( char* ) (
+		( ( uintptr_t ) mem + align - 1 ) & ~ ( ( uintptr_t ) align - 1 )
+	);
+
+	if( aligned > mem )
+		munmap( mem, aligned - mem );
+
+	if( ( aligned + size ) < ( mem + map_sz ) )
+		munmap( aligned + size, ( mem + map_sz ) - ( aligned + size ) );
+
+	_bind( aligned, size, node );
+
+	return aligned;
+}
+
+void numa_free( void *mem, size_t size ) {
+	if( mem == NULL )
+		return;
+
+	size_t page = _page_size();
+
+	munmap( mem, ( size + page - 1 ) & ~ ( page - 1 ) );
+}
@@ -0,0 +1,29 @@
+#ifndef LIBNUMA_UTILS
+#define LIBNUMA_UTILS
+
+#include <stddef.h>
+
+// upper bound for node identifiers
+#ifndef NUMA_MAX_NODES
+	#define NUMA_MAX_NODES 64
+#endif
+
+// if the variable is set to N > 0 then topology isn't read from sysfs;
+// CPUs are dealt to N nodes round-robin and memory isn't bound so node
+// aware paths can be exercised on a single-node machine
+#define NUMA_FAKE_ENV "RECLAIM_FAKE_NUMA"
+
+// topology is discovered once on the first call of any of these; machine
+// without sysfs node information is treated as one node
+extern size_t numa_nodes_num( void );
+// node of the CPU the calling thread runs on at the moment
+extern int numa_current_node( void );
+
+// memory is mapped with page granularity, zeroed and aligned on align
+// (power of 2); pages are placed on the node if the kernel supports
+// mbind(2) and the topology isn't fake
+extern void *numa_alloc_onnode( size_t size, size_t align, int node );
+// size must be the same as for numa_alloc_onnode
+extern void numa_free( void *mem, size_t size );
+
+#endif
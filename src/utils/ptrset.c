@@ -0,0 +1,187 @@
+#include <utils/ptrset.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include <reclaim_config.h>
+
+#if defined( __AVX2__ ) && ( __SIZEOF_POINTER__ == 8 )
+	#include <immintrin.h>
+	#define GROUP_SIZE 4
+#elif defined( __SSE2__ ) && ( __SIZEOF_POINTER__ == 8 )
+	#include <emmintrin.h>
+	#define GROUP_SIZE 2
+#else
+	#define GROUP_SIZE 1
+#endif
+
+#define MIN_CAPACITY ( sizeof( void* ) * 8 )
+
+// groups are loaded with aligned loads
+#define KEYS_ALIGN 32
+
+inline static size_t _hash( void *key ) {
+	// Fibonacci hashing; lower bits of pointers are always zero due to
+	// alignment so they are shifted away first
+	uint64_t h = ( ( uint64_t ) ( uintptr_t ) key >> 3 ) *
+		11400714819323198485ull;
+
+	return ( size_t ) ( h >> 32 );
+}
+
+// returns bit mask of slots in the group equal to key; bit mask of empty
+// slots in the group is stored into empty
+inline static unsigned _group_match( void * const *group,
+	void *key,
+	unsigned *empty
+) {
+#if GROUP_SIZE == 4
+	__m256i keys = _mm256_load_si256( ( const __m256i* ) group );
+	__m256i needle = _mm256_set1_epi64x( ( long long ) ( uintptr_t ) key );
+
+	*empty = _mm256_movemask_pd( _mm256_castsi256_pd(
+		_mm256_cmpeq_epi64( keys, _mm256_setzero_si256() )
+	) );
+
+	return _mm256_movemask_pd( _mm256_castsi256_pd(
+		_mm256_cmpeq_epi64( keys, needle )
+	) );
+#elif GROUP_SIZE == 2
+	__m128i keys = _mm_load_si128( ( const __m128i* ) group );
+	__m128i needle = _mm_set1_epi64x( ( long long ) ( uintptr_t ) key );
+
+	// SSE2 has no 64-bit comparison; both 32-bit halves have to match
+	__m128i eq = _mm_cmpeq_epi32( keys, needle );
+	eq = _mm_and_si128( eq, _mm_shuffle_epi32( eq, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	__m128i zero = _mm_cmpeq_epi32( keys, _mm_setzero_si128() );
+	zero = _mm_and_si128( zero,
+		_mm_shuffle_epi32( zero, _MM_SHUFFLE( 2, 3, 0, 1 ) )
+	);
+
+	*empty = _mm_movemask_pd( _mm_castsi128_pd( zero ) );
+
+	return _mm_movemask_pd( _mm_castsi128_pd( eq ) );
+#else
+	*empty = ( group[ 0 ] == NULL );
+
+	return ( group[ 0 ] == key );
+#endif
+}
+
+void ptrset_init( ptrset_t *set ) {
+	assert( set != NULL );
+
+	set->capacity = 0;
+	set->size = 0;
+	set->keys = NULL;
+}
+
+static void _allocate( ptrset_t *set, size_t capacity ) {
+	void *keys = NULL;
+
+	posix_memalign( &keys, KEYS_ALIGN, sizeof( void* ) * capacity );
+	memset( keys, 0, sizeof( void* ) * capacity );
+
+	set->keys = keys;
+	set->capacity = capacity;
+	set->size = 0;
+}
+
+void ptrset_reset( ptrset_t *set, size_t expected ) {
+	assert( set != NULL );
+
+	// load factor is kept under 1/2
+	size_t capacity = MIN_CAPACITY;
+	while( capacity < expected * 2 )
+		capacity <<= 1;
+
+	if( capacity > set->capacity ) {
+		free( set->keys );
+		_allocate( set, capacity );
+	} else if( set->size > 0 ) {
+		memset( set->keys, 0, sizeof( void* ) * set->capacity );
+		set->size = 0;
+	}
+}
+
+// keys are put into the first empty slot starting from the beginning of
+// the home group; hence every group before one holding the key is full and
+// lookup can stop at the first group having an empty slot
+static int _insert_no_grow( ptrset_t *set, void *key ) {
+	size_t mask = set->capacity - 1;
+	unsigned empty;
+
+	for( size_t gidx = _hash( key ) & mask & ( ~( size_t ) ( GROUP_SIZE - 1 ) );
+		;
+		gidx = ( gidx + GROUP_SIZE ) & mask
+	) {
+		if( _group_match( set->keys + gidx, key, &empty ) )
+			return 0;
+
+		if( empty ) {
+			set->keys[ gidx + __builtin_ctz( empty ) ] = key;
+			++set->size;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void _grow( ptrset_t *set ) {
+	void **old_keys = set->keys;
+	size_t old_capacity = set->capacity;
+
+	_allocate( set, old_capacity * 2 );
+
+	for( size_t i = 0; i < old_capacity; ++i )
+		if( old_keys[ i ] != NULL )
+			_insert_no_grow( set, old_keys[ i ] );
+
+	free( old_keys );
+}
+
+void ptrset_insert( ptrset_t *set, void *key ) {
+	assert( set != NULL );
+	assert( key != NULL );
+
+	if( set->capacity == 0 )
+		ptrset_reset( set, 0 );
+
+	if( ( set->size + 1 ) * 2 > set->capacity )
+		_grow( set );
+
+	_insert_no_grow( set, key );
+}
+
+int ptrset_contains( const ptrset_t *set, void *key ) {
+	assert( set != NULL );
+
+	if( set->size == 0 )
+		return 0;
+
+	size_t mask = set->capacity - 1;
+	unsigned empty;
+
+	for( size_t gidx = _hash( key ) & mask & ( ~( size_t ) ( GROUP_SIZE - 1 ) );
+		;
+		gidx = ( gidx + GROUP_SIZE ) & mask
+	) {
+		if( _group_match( set->keys + gidx, key, &empty ) )
+			return 1;
+
+		if( empty )
+			return 0;
+	}
+
+	return 0;
+}
+
+void ptrset_destroy( ptrset_t *set ) {
+	assert( set != NULL );
+
+	free( set->keys );
+	ptrset_init( set );
+}
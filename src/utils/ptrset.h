@@ -0,0 +1,24 @@
+#ifndef LIBPTRSET
+#define LIBPTRSET
+
+#include <stddef.h>
+
+// open-addressing set of pointers; probing goes group by group where
+// group is a number of consecutive slots which is compared against the key
+// at once with SIMD instructions (AVX2, SSE2 or scalar fallback);
+// NULL is a reserved value for an empty slot
+typedef struct {
+	size_t capacity;
+	size_t size;
+	void **keys;
+} ptrset_t;
+
+extern void ptrset_init( ptrset_t *set );
+// prepares set for at least expected number of keys and empties it;
+// memory is reused between calls
+extern void ptrset_reset( ptrset_t *set, size_t expected );
+extern void ptrset_insert( ptrset_t *set, void *key );
+extern int ptrset_contains( const ptrset_t *set, void *key );
+extern void ptrset_destroy( ptrset_t *set );
+
+#endif
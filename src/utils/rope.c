@@ -1,10 +1,16 @@
 #include <utils/rope.h>
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
 #include <atomic_ops.h>
 
 #include <reclaim_config.h>
 #include <utils/faa.h>
+#include <utils/futex.h>
+#include <utils/bitmap.h>
 
 #define INITIAL_POINTERS_NUMBER ( sizeof( AO_t ) * 8 )
 #define INITIAL_TOTAL_SIZE ( sizeof( rope_t ) + \
@@ -46,51 +52,32 @@ rope_t *rope_create( void ) {
 
 #define WORD_POW ( ffsl( INITIAL_POINTERS_NUMBER ) - 1 )
 
-inline static void _map_change_for( AO_t map[],
-	size_t capacity,
-	AO_t idx,
-	int is_put
-) {
+// map is flat: bit per slot which is set if slot is occupied; searches go
+// through whole words (and blocks of words if vector instructions are
+// available) so summary levels aren't needed
+inline static void _map_change_for( AO_t map[], size_t idx, int is_put ) {
 	assert( map != NULL );
 
-	int widx = idx >> WORD_POW;
-	map[ widx ] |= 1 << ( idx & BIT_NUMBER_MASK );
-	AO_t mask = 3 << ( idx & BIT_NUMBER_MASK & ( ~1ul ) );
-	int is_full = ( map[ widx ] & mask ) == mask;
-	
-	idx >>= 1;
-	widx >>= 1;
-	mask = 3 << ( idx & BIT_NUMBER_MASK & ( ~1ul ) );
-	capacity >>= WORD_POW;
-	AO_t wbit = 1 << ( idx & BIT_NUMBER_MASK );
-	for( int level_border = capacity, midx = level_border + widx * 2;
-		capacity > 1;
-			idx >>= 1,
-			wbit = 1 << ( idx & BIT_NUMBER_MASK ),
-			capacity >>= 1,
-			level_border += capacity * 2,
-			widx >>= 1,
-			midx = level_border + widx * 2,
-			mask = 3 << ( idx & BIT_NUMBER_MASK & ( ~1ul ) )
-	) {
-		map[ midx + ( ! is_put ) ] |= wbit
-		if( is_full )
-			map[ midx + is_put ] &= ~ wbit;
-
-		is_full = ( map[ midx + ( ! is_put ) ] & mask ) == mask;
-	}
+	if( is_put )
+		map[ idx >> WORD_POW ] |= 1ul << ( idx & BIT_NUMBER_MASK );
+	else
+		map[ idx >> WORD_POW ] &= ~ ( 1ul << ( idx & BIT_NUMBER_MASK ) );
 }
 
 inline static size_t _calc_map_len( size_t capacity ) {
-	return 3 * ( capacity >> WORD_POW ) - 2;
+	return capacity >> WORD_POW;
 }
 
-inline static rope_chunk_t *_create_chunk( size_t capacity ) {
-	size_t map_len = _calc_map_len( capacity );
-	size_t chunk_sz = sizeof( rope_chunk_t ) +
+inline static size_t _calc_chunk_size( size_t capacity ) {
+	return sizeof( rope_chunk_t ) +
 		sizeof( AO_t ) * capacity +
 		sizeof( void* ) * capacity +
-		sizeof( AO_t ) * map_len;
+		sizeof( AO_t ) * _calc_map_len( capacity );
+}
+
+inline static rope_chunk_t *_create_chunk( size_t capacity ) {
+	size_t map_len = _calc_map_len( capacity );
+	size_t chunk_sz = _calc_chunk_size( capacity );
 
 	rope_chunk_t *rope_chunk = malloc( chunk_sz );
 	memset( rope_chunk, 0, chunk_sz );
@@ -102,14 +89,6 @@ inline static rope_chunk_t *_create_chunk( size_t capacity ) {
 	rope_chunk->ptrs = ( void** ) (
 		( ( char* ) rope_chunk->map ) + sizeof( AO_t ) * map_len
 	);
-	
-	for( AO_t *cur = rope_chunk->map + 1,
-			limit = ( ( AO_t* ) rope_chunk->ptrs ) - ( capacity >> WORD_POW );
-		cur < limit;
-		cur += 2
-	)
-		*cur = SIZE_MAX;
-
 	rope_chunk->claims = ( AO_t* ) (
 		( ( char* ) rope_chunk->ptrs ) + ( sizeof( void* ) * capacity )
 	);
@@ -129,7 +108,7 @@ enum _find_what {
 	FIND_OCCUPIED = 0
 };
 
-static void _assign_to_rope_ptr( rope_ptr_t *ptr, size_t idx ) {
+static void _assign_to_rope_ptr( rope_ptr_t *init_ptr, size_t idx ) {
 	init_ptr->idx = idx;
 	init_ptr->ptr = &( init_ptr->chunk->ptrs[ init_ptr->idx ] );
 	init_ptr->claim = &( init_ptr->chunk->claims[ init_ptr->idx ] );
@@ -142,241 +121,169 @@ static void _nullify_ptr( rope_ptr_t *ptr ) {
 	ptr->idx = 0;
 }
 
-inline static size_t _ffsl_after( AO_t mword, size_t idx ) {
-	int ret = ffsl( mword >> idx );
-	
-	if( ret )
-		return ( idx + ret );
-	else
-		return 0;
-
-	return 0;
-}
-
-static int _ffcl_after( AO_t mword, size_t idx ) {
-	AO_t mask = 1 << idx;
-	for( int cyc = idx + 1;
-		cyc <= ( sizeof( unsigned long ) * 8 );
-		++cyc, mask <<= 1
-	)
-		if( mval & mask )
-			return cyc;
-
-	return 0;
-}
-
-static int _map_bob_up( AO_t map[],
+// returns SIZE_MAX if there is no such slot at or after start_idx
+inline static size_t _discover_map( AO_t map[],
 	size_t capacity,
-	int *level,
-	size_t *idx,
+	size_t start_idx,
 	int which
 ) {
-	int level_limit = ffsl( capacity ) - WORD_POW;
-
-	if( *level < 1 ) {
-		AO_t mword = AO_load( &( map[ idx >> WORD_POW ] ) );
-		size_t bitn = ( which == FIND_OCCUPIED ) ?
-			_ffsl_after( mword, idx & BIT_NUMBER_MASK ) :
-			_ffcl_after( mword, idx & BIT_NUMBER_MASK );
-			
-		if( bitn != 0 ) {
-			*idx = *idx & ( ~ BIT_NUMBER_MASK ) | ( bitn - 1 );
-			return 1;
-		}
-
-		if( ( level + 1 ) >= level_limit )
-			return 0;
-
-		
-		size_t new_idx = *idx & ( ~ BIT_NUMBER_MASK ) +
-			INITIAL_POINTERS_NUMBER;
-
-		if( new_idx >= capacity  )
-			return 0;
-
-		++( *level );
-		*idx = new_idx >> 1;
-	}
+	return ( which == FIND_OCCUPIED ) ?
+		bitmap_find_set( map, _calc_map_len( capacity ), start_idx ) :
+		bitmap_find_clear( map, _calc_map_len( capacity ), start_idx );
+}
 
-	AO_t *level_border = map +
-		_calc_map_len( capacity ) -
-		( 1 << ( level_limit - level ) - 1 ) * 2;
+// looks through the rest of the current chunk and then through
+// the following chunks from their beginning
+static int _find_next( rope_ptr_t *init_ptr, int which ) {
+	assert( init_ptr != NULL );
 
-	capacity >>= level;
+	size_t new_idx = 0;
+	size_t start_idx = init_ptr->idx;
 
-	for( size_t bitn = 0, new_idx = 0;
-		( *level ) < level_limit;
-		++( *level )
+	for( rope_chunk_t *curc = init_ptr->chunk;
+		curc != NULL;
+		curc = ( rope_chunk_t* ) AO_load( ( AO_t* ) &( curc->next ) ),
+			start_idx = 0
 	) {
-		bitn = _ffsl_after(
-			AO_load( &( level_border[ idx >> WORD_POW + which ] ) ),
-			idx & BIT_NUMBER_MASK
-		);
-			
-		if( bitn != 0 ) {
-			*idx = *idx & ( ~ BIT_NUMBER_MASK ) | ( bitn - 1 );
+		new_idx = _discover_map( curc->map, curc->capacity, start_idx, which );
+
+		if( new_idx != SIZE_MAX ) {
+			init_ptr->chunk = curc;
+			_assign_to_rope_ptr( init_ptr, new_idx );
 			return 1;
 		}
-
-		
-		new_idx = *idx & ( ~ BIT_NUMBER_MASK ) +
-			INITIAL_POINTERS_NUMBER;
-
-		if( new_idx >= capacity  )
-			return 0;
-
-		*idx = new_idx >> 1;
-		level_border += capacity * 2;
-		capacity >>= 1;
 	}
 
+	_nullify_ptr( init_ptr );
 	return 0;
 }
 
-static int _map_sink( AO_t map[],
-	size_t capacity,
-	int *level,
-	size_t *idx,
-	int which
-) {
-	if( *level < 1 )
-		return 1;
+// spare chunk is private to the owner so it's cleared in place; pointers
+// inside of the chunk stay valid
+inline static rope_chunk_t *_reuse_chunk( rope_t *where ) {
+	rope_chunk_t *chunk = where->spare;
 
-	int level_limit = ffsl( capacity ) - WORD_POW;
+	if( ( chunk == NULL ) || ( chunk->capacity != where->capacity ) )
+		return _create_chunk( where->capacity );
 
-	--( *level );
+	where->spare = NULL;
+	memset( chunk->map,
+		0,
+		_calc_chunk_size( chunk->capacity ) - sizeof( rope_chunk_t )
+	);
+	chunk->next = NULL;
+	chunk->used = 0;
 
-	capacity >>= level;
-	*idx <<= 1;
+	AO_nop_full();
 
-	if( *level > 0 ) {
-		AO_t *level_border = map +
-			_calc_map_len( capacity ) -
-			( 1 << ( level_limit - level ) - 1 ) * 2;
+	return chunk;
+}
 
-		for( size_t bitn = 0;
-			( *level ) > 0 ;
-			--( *level )
-		) {
-			bitn = _ffsl_after(
-				AO_load( &( level_border[ idx >> WORD_POW + which ] ) ),
-				idx & BIT_NUMBER_MASK
-			);
+inline static void _append_chunk( rope_t *where ) {
+	where->last_chunk->next =
+		where->first_free_ptr.chunk =
+			_reuse_chunk( where );
+	where->first_free_ptr.idx = 0;
+	where->first_free_ptr.claim = where->first_free_ptr.chunk->claims;
+	where->first_free_ptr.ptr = where->first_free_ptr.chunk->ptrs;
+	where->last_chunk = where->last_chunk->next;
+	where->capacity *= 2;
+}
 
-			if( bitn == 0 )
-				return 0;
+// alien iterators and helpers find slots through the map so pointers are
+// published before the bits; bits of one word are set with one store
+inline static void _map_publish( AO_t *word, AO_t bits ) {
+	if( bits != 0 )
+		AO_store_release( word, *word | bits );
+}
 
-			*idx = *idx & ( ~ BIT_NUMBER_MASK ) | ( bitn - 1 );
+inline static void _owner_put_one( rope_t *where, void *ptr ) {
+	rope_ptr_t *free_ptr = &( where->first_free_ptr );
 
-			*idx <<= 1;
-			capacity <<= 1;
-			level_border -= capacity * 2;
-		}
-	}
+	*( free_ptr->ptr ) = ptr;
+	++where->ptrs_number;
+	++free_ptr->chunk->used;
+	_map_publish( &( free_ptr->chunk->map[ free_ptr->idx >> WORD_POW ] ),
+		1ul << ( free_ptr->idx & BIT_NUMBER_MASK )
+	);
+}
 
-	AO_t mword = AO_load( &( map[ idx >> WORD_POW ] ) );
-	size_t bitn = ( which == FIND_OCCUPIED ) ?
-		_ffsl_after( mword, idx & BIT_NUMBER_MASK ) :
-		_ffcl_after( mword, idx & BIT_NUMBER_MASK );
+void rope_owner_put( rope_t *where, void *ptr ) {
+	assert( where != NULL );
+	assert( where->first_free_ptr.chunk != NULL );
+	assert( ptr != NULL );
+	
+	_owner_put_one( where, ptr );
 
-	if( bitn != 0 ) {
-		*idx = *idx & ( ~ BIT_NUMBER_MASK ) | ( bitn - 1 );
-		return 1;
+	if( where->ptrs_number >= where->capacity )
+		_append_chunk( where );
+	else {
+		int is_found = _find_next( &( where->first_free_ptr ), FIND_FREE );
+		assert( is_found );
 	}
-
-	return 0;
 }
 
-static size_t _discover_map( AO_t map[],
-	size_t capacity,
-	size_t start_idx,
-	int which
-) {
-	int level = 0;
+// slot right after the one just filled is usually free (deletions are
+// sparse compared to appends) so full search through the map is done only
+// when it isn't; slots are filled first and bits collected for a map word
+// are published once the free pointer leaves the word or the map has to
+// be searched
+void rope_owner_put_n( rope_t *where, void * const *ptrs, size_t n ) {
+	assert( where != NULL );
+	assert( where->first_free_ptr.chunk != NULL );
 
-	do {
-		if( ! _map_bob_up( map, capacity, &level, &start_idx, which ) )
-			return SIZE_MAX;
-	} while (
-		! _map_sink( map, capacity, &level, &start_idx, which )
-	)
+	rope_ptr_t *free_ptr = &( where->first_free_ptr );
+	AO_t *word = NULL, *cur;
+	AO_t bits = 0;
+	size_t next;
 
-	return idx;
-}
+	for( size_t i = 0; i < n; ++i ) {
+		assert( ptrs[ i ] != NULL );
 
-static int _find_next( rope_ptr_t *init_ptr, int which ) {
-	assert( init_ptr != NULL );
-	
-	if( init_ptr->chunk == NULL )
-		return 0;
+		cur = &( free_ptr->chunk->map[ free_ptr->idx >> WORD_POW ] );
 
-	int is_changed = 0;
-	if( init_ptr->chunk->capacity == INITIAL_POINTERS_NUMBER ) {
-		size_t new_idx = _discover_map( init_ptr->chunk->map,
-			INITIAL_POINTERS_NUMBER,
-			init_ptr->idx,
-			which
-		)
+		if( cur != word ) {
+			_map_publish( word, bits );
+			word = cur;
+			bits = 0;
+		}
 
-		if( new_idx != SIZE_MAX ) {
-			_assign_to_rope_ptr( init_ptr, new_idx );
-			return 1;
+		*( free_ptr->ptr ) = ptrs[ i ];
+		++where->ptrs_number;
+		++free_ptr->chunk->used;
+		bits |= 1ul << ( free_ptr->idx & BIT_NUMBER_MASK );
+
+		if( where->ptrs_number >= where->capacity ) {
+			_map_publish( word, bits );
+			word = NULL;
+			bits = 0;
+			_append_chunk( where );
+			continue;
 		}
 
-		init_ptr->chunk = AO_load( &( init_ptr->chunk->next ) );
-		is_changed = 1;
-	}
+		next = free_ptr->idx + 1;
 
-	size_t new_idx = 0;
-	for( rope_chunk_t *curc = init_ptr->chunk;
-		curc != NULL;
-		curc = AO_load( curc->next ), is_changed = 1
-	)
-		if( AO_load(
-				&( curc->map[ _calc_map_len( curc->capacity ) - 2 + which ] )
-			) != 0
-		) {
-			new_idx = _discover_map( curc->map, curc->capacity, 0, which );
+		if( ( next < free_ptr->chunk->capacity ) &&
+			! ( free_ptr->chunk->map[ next >> WORD_POW ] &
+				( 1ul << ( next & BIT_NUMBER_MASK ) ) )
+		)
+			_assign_to_rope_ptr( free_ptr, next );
+		else {
+			// the search must see the slots which have just been filled
+			_map_publish( word, bits );
+			word = NULL;
+			bits = 0;
 
-			if( new_idx != SIZE_MAX ) {
-				_assign_to_rope_ptr( init_ptr, new_idx );
-				return 1;
-			}
+			int is_found = _find_next( free_ptr, FIND_FREE );
+			assert( is_found );
 		}
+	}
 
-	_nullify_ptr( init_ptr );
-	return 0;
-}
-
-void rope_owner_put( rope_t *where, void *ptr ) {
-	assert( where != NULL );
-	assert( where->first_free_chunk != NULL );
-	assert( ptr != NULL );
-	
-	*( where->first_free_ptr.ptr ) = what;
-	++where->ptrs_number;
-	_map_change_for(
-		where->first_free_ptr.chunk->map,
-		where->first_free_ptr.chunk->capacity,
-		where->first_free_ptr.idx,
-		MARK_AS_OCCUPIED
-	);
-
-	if( where->ptrs_number >= where->capacity ) {
-		where->last_chunk->next =
-			where->first_free_ptr.chunk =
-				_create_chunk( where->capacity );
-		where->first_free_ptr.idx = 0;
-		where->first_free_ptr.claim = where->first_free_ptr.chunk->claims;
-		where->first_free_ptr.ptr = where->first_free_ptr.chunk->ptrs;
-		where->last_chunk = where->last_chunk->next;
-		where->capacity *= 2;
-	} else
-		assert( _find_next( &( where->first_free_ptr ), FIND_FREE ) );
+	_map_publish( word, bits );
 }
 
 int rope_iterator_create( const rope_t *rope, rope_ptr_t *iter ) {
-	iter->chunk = rope->first_chunk;
+	iter->chunk = ( rope_chunk_t* ) &( rope->first_chunk );
 	iter->idx = 0;
 	iter->ptr = iter->chunk->ptrs;
 	iter->claim = iter->chunk->claims;
@@ -409,44 +316,99 @@ int rope_iterator_next( rope_ptr_t *iter ) {
 	return _find_next( iter, FIND_OCCUPIED );
 }
 
+int rope_run_first( const rope_t *rope, rope_run_t *run ) {
+	run->chunk = ( rope_chunk_t* ) &( rope->first_chunk );
+	run->idx = 0;
+	run->len = 0;
+
+	return rope_run_next( run );
+}
+
+// the next run starts after the end of the current one; slots freed
+// meanwhile inside of the current run don't matter
+int rope_run_next( rope_run_t *run ) {
+	size_t start_idx = run->idx + run->len;
+	size_t map_len, idx;
+
+	for( rope_chunk_t *curc = run->chunk;
+		curc != NULL;
+		curc = ( rope_chunk_t* ) AO_load( ( AO_t* ) &( curc->next ) ),
+			start_idx = 0
+	) {
+		map_len = _calc_map_len( curc->capacity );
+		idx = bitmap_find_set( curc->map, map_len, start_idx );
+
+		if( idx != SIZE_MAX ) {
+			run->chunk = curc;
+			run->idx = idx;
+			run->len = bitmap_run_length( curc->map, map_len, idx );
+			return 1;
+		}
+	}
+
+	run->chunk = NULL;
+	run->idx = 0;
+	run->len = 0;
+	return 0;
+}
+
 #define PTR_DONE ( 1ul )
 
 void *rope_owner_iterator_deref( rope_ptr_t *iter ) {
 	if( iter->ptr == NULL )
 		return NULL;
 
-	return *( iter->ptr ) & ( ~ PTR_DONE );
+	return ( void* ) ( ( AO_t ) *( iter->ptr ) & ( ~ PTR_DONE ) );
 }
 
-int rope_owner_delete( rope_t *rope, rope_ptr_t *iter ) {
-	void *ptr = *( iter->ptr );
-	AO_store( iter->ptr, NULL );
+// tombstone has no object so both owner and alien iterators see
+// the slot as empty
+#define PTR_STOLEN ( PTR_DONE )
 
-	AO_nop_full();
-	
-	if( AO_load( iter->claim ) == 0 ) {
-		_map_change_for(
-			iter->chunk->map,
-			iter->chunk->capacity,
-			iter->idx,
-			MARK_AS_FREE
-		);
+static void _owner_free_slot( rope_t *rope, rope_ptr_t *iter ) {
+	_map_change_for(
+		iter->chunk->map,
+		iter->idx,
+		MARK_AS_FREE
+	);
 
-		--rope->ptrs_number;
+	--rope->ptrs_number;
+	--iter->chunk->used;
 
-		if ( iter->chunk == rope->first_free_ptr.chunk ) {
-			if( iter->idx < rope->first_free_ptr.idx )
-				rope->first_free_ptr = *iter;
-		} else {
-			if( iter->chunk->capacity < rope->first_free_ptr.chunk->capacity )
-				rope->first_free_ptr = *iter;
-		}
+	// chunks grow along the rope except for the first two which are of
+	// the same size
+	if ( iter->chunk == rope->first_free_ptr.chunk ) {
+		if( iter->idx < rope->first_free_ptr.idx )
+			rope->first_free_ptr = *iter;
+	} else {
+		if( ( iter->chunk == &( rope->first_chunk ) ) ||
+			( iter->chunk->capacity < rope->first_free_ptr.chunk->capacity )
+		)
+			rope->first_free_ptr = *iter;
+	}
+}
+
+// the slot is emptied before claim is checked; alien iterator either sees
+// it empty or its claim is seen here
+inline static int _delete_unless_claimed( rope_ptr_t *iter ) {
+	void *ptr = ( void* ) AO_load( ( AO_t* ) iter->ptr );
+	AO_store( ( AO_t* ) iter->ptr, ( AO_t ) NULL );
 
+	AO_nop_full();
+
+	if( AO_load( iter->claim ) == 0 )
 		return 1;
-	} else {
-		AO_store( iter->ptr, ptr | PTR_DONE );
+
+	AO_store( ( AO_t* ) iter->ptr, ( AO_t ) ptr | PTR_DONE );
+	return 0;
+}
+
+int rope_owner_delete( rope_t *rope, rope_ptr_t *iter ) {
+	if( ! _delete_unless_claimed( iter ) )
 		return 0;
-	}
+
+	_owner_free_slot( rope, iter );
+	return 1;
 }
 
 int rope_owner_delete_at( rope_t *rope, rope_chunk_t *chunk, size_t idx ) {
@@ -457,16 +419,16 @@ int rope_owner_delete_at( rope_t *rope, rope_chunk_t *chunk, size_t idx ) {
 		.claim = &( chunk->claims[ idx ] )
 	};
 
-	return rope_owner_delete( rope, &iter );
+	return rope_owner_delete( rope, &ptr );
 }
 
 void *rope_alien_iterator_deref( rope_ptr_t *iter ) {
-	void *ptr = AO_load( iter->ptr );
+	void *ptr = ( void* ) AO_load( ( AO_t* ) iter->ptr );
 
-	if( ( ptr != NULL ) && ( ! ( ptr & PTR_DONE ) ) ) {
+	if( ( ptr != NULL ) && ( ! ( ( AO_t ) ptr & PTR_DONE ) ) ) {
 		fetch_and_inc( iter->claim );
 		
-		if( AO_load( iter->ptr ) == ptr )
+		if( ( void* ) AO_load( ( AO_t* ) iter->ptr ) == ptr )
 			return ptr;
 
 		fetch_and_dec( iter->claim );
@@ -481,6 +443,77 @@ void rope_alien_iterator_release( rope_ptr_t *iter ) {
 	fetch_and_dec( iter->claim );
 }
 
+int rope_chunk_try_claim( rope_chunk_t *chunk ) {
+	return ( AO_load( &( chunk->steal ) ) == 0 ) &&
+		AO_compare_and_swap_full( &( chunk->steal ), 0, 1 );
+}
+
+void rope_chunk_unclaim( rope_chunk_t *chunk ) {
+	AO_store_full( &( chunk->steal ), 0 );
+}
+
+// other threads hold chunks only for one pass through them so the owner
+// spins and then yields
+static void _owner_claim( rope_chunk_t *chunk ) {
+	for( int i = 0; ! rope_chunk_try_claim( chunk ); ++i )
+		if( i < FUTEX_SPIN_ITERATIONS )
+			cpu_relax();
+		else
+			sched_yield();
+}
+
+static void _owner_reap( rope_t *rope, rope_chunk_t *chunk ) {
+	rope_run_t run = { .chunk = chunk, .idx = 0, .len = 0 };
+	rope_ptr_t iter;
+	AO_t stolen = AO_load( &( chunk->stolen ) );
+
+	if( stolen == 0 )
+		return;
+
+	while( rope_run_next( &run ) && ( run.chunk == chunk ) )
+		for( size_t i = 0; i < run.len; ++i )
+			if( ( AO_t ) chunk->ptrs[ run.idx + i ] == PTR_STOLEN ) {
+				rope_iterator_create_with( &iter, chunk, run.idx + i );
+				AO_store( ( AO_t* ) iter.ptr, ( AO_t ) NULL );
+				_owner_free_slot( rope, &iter );
+			}
+
+	AO_store( &( chunk->stolen ), 0 );
+}
+
+void rope_owner_claim_all( rope_t *rope ) {
+	assert( rope != NULL );
+
+	for( rope_chunk_t *curc = &( rope->first_chunk );
+		curc != NULL;
+		curc = curc->next
+	) {
+		_owner_claim( curc );
+		_owner_reap( rope, curc );
+	}
+}
+
+void rope_owner_unclaim_all( rope_t *rope ) {
+	assert( rope != NULL );
+
+	for( rope_chunk_t *curc = &( rope->first_chunk );
+		curc != NULL;
+		curc = curc->next
+	)
+		rope_chunk_unclaim( curc );
+}
+
+// stolen counter is changed after the tombstone is in place so the owner
+// never misses it
+int rope_alien_delete( rope_ptr_t *iter ) {
+	if( ! _delete_unless_claimed( iter ) )
+		return 0;
+
+	AO_store( ( AO_t* ) iter->ptr, PTR_STOLEN );
+	fetch_and_inc( &( iter->chunk->stolen ) );
+	return 1;
+}
+
 static int _compare_ptrs( const void *a, const void *b ) {
 	void *ptr_a = ( ( shadow_ptr_t* ) a )->ptr,
 		*ptr_b = ( ( shadow_ptr_t* ) b )->ptr;
@@ -503,20 +536,29 @@ void rope_owner_sort( rope_t *what, sorted_rope_t *to ) {
 				malloc(
 					sizeof( shadow_ptr_t ) * what->ptrs_number
 				);
+		what->shadow.capacity = what->ptrs_number;
 	}
 
-	rope_ptr_t iter;
-	rope_iterator_create( what, &iter )
-	for( int cyc = 0;
-		cyc < what->ptrs_number;
-		rope_iterator_next( &iter ), ++cyc
-	) {
-		ptrs[ cyc ].ptr = rope_owner_iterator_deref( &iter );
-		ptrs[ cyc ].idx = iter.idx;
-		ptrs[ cyc ].chunk = iter.chunk;
-	}
+	rope_run_t run;
+	size_t cyc = 0;
+	for( int cont = rope_run_first( what, &run );
+		cont && ( cyc < what->ptrs_number );
+		cont = rope_run_next( &run )
+	)
+		for( size_t i = 0;
+			( i < run.len ) && ( cyc < what->ptrs_number );
+			++i, ++cyc
+		) {
+			ptrs[ cyc ].ptr = ( void* ) (
+				( AO_t ) run.chunk->ptrs[ run.idx + i ] & ( ~ PTR_DONE )
+			);
+			ptrs[ cyc ].idx = run.idx + i;
+			ptrs[ cyc ].chunk = run.chunk;
+		}
 
-	qsort( ptrs, what->ptrs_number, sizeof( shadow_ptr_t ), _compare_ptrs );
+	// buffer is NULL for empty rope after shrinking
+	if( what->ptrs_number > 1 )
+		qsort( ptrs, what->ptrs_number, sizeof( shadow_ptr_t ), _compare_ptrs );
 
 	to->ptrs_number = what->ptrs_number;
 	to->ptrs = ptrs;
@@ -525,7 +567,10 @@ void rope_owner_sort( rope_t *what, sorted_rope_t *to ) {
 shadow_ptr_t *rope_owner_find( sorted_rope_t *where, void *what ) {
 	shadow_ptr_t ptr = { .ptr = what };
 
-	return bsearch( ,
+	if( where->ptrs_number == 0 )
+		return NULL;
+
+	return bsearch( &ptr,
 		where->ptrs,
 		where->ptrs_number,
 		sizeof( shadow_ptr_t ),
@@ -533,17 +578,100 @@ shadow_ptr_t *rope_owner_find( sorted_rope_t *where, void *what ) {
 	);
 }
 
+#ifndef ROPE_SHRINK_RATIO
+	#define ROPE_SHRINK_RATIO 4
+#endif
+
+// capacity of the tail chunk is equal to the capacity of the rest so
+// every detached chunk halves the rope; chunks can't be detached if rope
+// would be more than half full without them which leaves room for
+// the next burst and stops growing and shrinking back and forth
+int rope_owner_shrink( rope_t *rope ) {
+	assert( rope != NULL );
+
+	if( ( rope->shadow.capacity > INITIAL_POINTERS_NUMBER ) &&
+		( rope->shadow.capacity > rope->ptrs_number * ROPE_SHRINK_RATIO )
+	) {
+		free( rope->shadow.ptrs );
+		rope->shadow.ptrs = NULL;
+		rope->shadow.capacity = 0;
+	}
+
+	if( rope->ptrs_number * ROPE_SHRINK_RATIO > rope->capacity )
+		return 0;
+
+	int is_shrunk = 0;
+	rope_chunk_t *prev;
+
+	while( ( rope->last_chunk != &( rope->first_chunk ) ) &&
+		( rope->last_chunk->used == 0 ) &&
+		( rope->ptrs_number * 2 <=
+			rope->capacity - rope->last_chunk->capacity )
+	) {
+		for( prev = &( rope->first_chunk );
+			prev->next != rope->last_chunk;
+			prev = prev->next
+		);
+
+		// alien iterator standing on the chunk proceeds to the other
+		// retired chunks which are empty as well
+		AO_store( ( AO_t* ) &( prev->next ), ( AO_t ) NULL );
+		rope->last_chunk->next = rope->retired;
+		rope->retired = rope->last_chunk;
+		rope->capacity -= rope->last_chunk->capacity;
+		rope->last_chunk = prev;
+		is_shrunk = 1;
+	}
+
+	if( is_shrunk ) {
+		rope->first_free_ptr.chunk = &( rope->first_chunk );
+		rope->first_free_ptr.idx = 0;
+
+		int is_found = _find_next( &( rope->first_free_ptr ), FIND_FREE );
+		assert( is_found );
+	}
+
+	return is_shrunk;
+}
+
+void rope_owner_free_retired( rope_t *rope ) {
+	assert( rope != NULL );
+
+	rope_chunk_t *next;
+
+	for( rope_chunk_t *curc = rope->retired; curc != NULL; curc = next ) {
+		next = curc->next;
+
+		if( ( rope->spare == NULL ) ||
+			( curc->capacity < rope->spare->capacity )
+		) {
+			free( rope->spare );
+			rope->spare = curc;
+		} else
+			free( curc );
+	}
+
+	rope->retired = NULL;
+}
+
 void rope_destroy( rope_t *what ) {
 	assert( what != NULL );
 	//TODO: implement something more clever and sync-aware
 	// now, we can steal a chair under logic which
 	// is working with it currently
-	
+
+	rope_chunk_t *next;
+
 	for( rope_chunk_t *curc = what->first_chunk.next;
 		curc != NULL;
-		curc = curc->next
-	)
+		curc = next
+	) {
+		next = curc->next;
 		free( curc );
+	}
 
+	rope_owner_free_retired( what );
+	free( what->spare );
+	free( what->shadow.ptrs );
 	free( what );
 }
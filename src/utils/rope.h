@@ -6,6 +6,14 @@
 typedef struct _rope_chunk {
 	struct _rope_chunk *next;
 	size_t capacity;
+	// number of occupied slots; changed by the owner only
+	size_t used;
+	// exclusive claim of the whole chunk taken by the owner for its scans
+	// or by another thread reclaiming objects on its behalf; slots
+	// emptied by the latter are left occupied by tombstones which are
+	// counted in stolen and freed by the owner when it claims the chunk
+	AO_t steal;
+	AO_t stolen;
 	// auxiliary list allows another threads walking through the thread
 	// context list mark particular node in deleted list with reference
 	// counter
@@ -34,6 +42,13 @@ typedef struct {
 	shadow_ptr_t *ptrs;
 } sorted_rope_t;
 
+// maximal sequence of occupied slots inside of one chunk
+typedef struct {
+	rope_chunk_t *chunk;
+	size_t idx;
+	size_t len;
+} rope_run_t;
+
 typedef struct {
 	size_t capacity;
 	size_t ptrs_number;
@@ -44,14 +59,29 @@ typedef struct {
 		size_t capacity;
 		shadow_ptr_t *ptrs;
 	} shadow;
+
+	// chunks detached by rope_owner_shrink which might still be walked
+	// by alien iterators and the chunk cached for the next growth
+	rope_chunk_t *retired;
+	rope_chunk_t *spare;
 	
 	rope_chunk_t first_chunk;
 } rope_t;
 
 extern rope_t *rope_create( void );
 extern void rope_owner_put( rope_t *where, void *ptr );
+extern void rope_owner_put_n( rope_t *where, void * const *ptrs, size_t n );
 extern int rope_iterator_create( const rope_t *rope, rope_ptr_t *iter );
 extern int rope_iterator_next( rope_ptr_t *iter );
+extern void rope_iterator_create_with( rope_ptr_t *iter,
+	rope_chunk_t *chunk,
+	size_t idx
+);
+// runs let callers walk through occupied slots without looking for
+// every next one; rope_iterator_create_with makes iterator for a slot
+// of the run
+extern int rope_run_first( const rope_t *rope, rope_run_t *run );
+extern int rope_run_next( rope_run_t *run );
 extern void *rope_owner_iterator_deref( rope_ptr_t *iter );
 extern int rope_owner_delete( rope_t *rope, rope_ptr_t *iter );
 extern int rope_owner_delete_at( rope_t *rope,
@@ -60,8 +90,28 @@ extern int rope_owner_delete_at( rope_t *rope,
 );
 extern void *rope_alien_iterator_deref( rope_ptr_t *iter );
 extern void rope_alien_iterator_release( rope_ptr_t *iter );
+// returns 0 if the chunk is claimed by somebody else
+extern int rope_chunk_try_claim( rope_chunk_t *chunk );
+extern void rope_chunk_unclaim( rope_chunk_t *chunk );
+// claims every chunk waiting for other threads to release theirs and
+// frees slots emptied by them; owner operations walking through occupied
+// slots must be done between the calls if chunks can be stolen
+extern void rope_owner_claim_all( rope_t *rope );
+extern void rope_owner_unclaim_all( rope_t *rope );
+// takes object out of the slot of the chunk claimed by the caller like
+// rope_owner_delete does: returns 1 if nobody holds claim on the slot and
+// the object can be freed; the slot is left with a tombstone then
+extern int rope_alien_delete( rope_ptr_t *iter );
 extern void rope_owner_sort( rope_t *what, sorted_rope_t *to );
 extern shadow_ptr_t *rope_owner_find( sorted_rope_t *where, void *what );
+// releases memory left after a burst of deletions: detaches empty chunks
+// from the tail and frees oversized sort buffer; nothing is done until
+// rope is at most 1 / ROPE_SHRINK_RATIO full and the rope is left at most
+// half full; returns 1 if some chunks were detached
+extern int rope_owner_shrink( rope_t *rope );
+// must be called once alien iterators can't be inside of detached chunks;
+// the smallest one is cached for reuse and the rest are freed
+extern void rope_owner_free_retired( rope_t *rope );
 extern void rope_destroy( rope_t *what );
 
 #endif
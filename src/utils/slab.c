@@ -0,0 +1,275 @@
+#include <utils/slab.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+#include <utils/numa.h>
+
+#include <reclaim_config.h>
+
+#ifdef AO_HAVE_compare_double_and_swap_double_full
+
+inline static void _depot_init( slab_depot_t *depot ) {
+	depot->top.AO_val1 = 0;
+	depot->top.AO_val2 = 0;
+}
+
+inline static void _depot_push( slab_depot_t *depot, slab_magazine_t *mag ) {
+	AO_t top, tag;
+
+	do {
+		tag = AO_load( &( depot->top.AO_val2 ) );
+		top = AO_load( &( depot->top.AO_val1 ) );
+		mag->next = ( slab_magazine_t* ) top;
+	} while(
+		! AO_compare_double_and_swap_double_full( &( depot->top ),
+			top, tag,
+			( AO_t ) mag, tag + 1
+		)
+	);
+}
+
+// magazines are never freed before slab_destroy so reading next field of
+// the magazine which has just been popped by another thread is safe;
+// the tag makes CAS fail in such case
+inline static slab_magazine_t *_depot_pop( slab_depot_t *depot ) {
+	AO_t top, tag;
+
+	do {
+		tag = AO_load( &( depot->top.AO_val2 ) );
+		top = AO_load( &( depot->top.AO_val1 ) );
+
+		if( top == 0 )
+			return NULL;
+	} while(
+		! AO_compare_double_and_swap_double_full( &( depot->top ),
+			top, tag,
+			( AO_t ) ( ( slab_magazine_t* ) top )->next, tag + 1
+		)
+	);
+
+	return ( slab_magazine_t* ) top;
+}
+
+#else
+
+inline static void _depot_init( slab_depot_t *depot ) {
+	depot->lock = AO_TS_INITIALIZER;
+	depot->top = NULL;
+}
+
+inline static void _depot_push( slab_depot_t *depot, slab_magazine_t *mag ) {
+	while( AO_test_and_set_full( &( depot->lock ) ) == AO_TS_SET );
+	mag->next = depot->top;
+	depot->top = mag;
+	AO_CLEAR( &( depot->lock ) );
+}
+
+inline static slab_magazine_t *_depot_pop( slab_depot_t *depot ) {
+	while( AO_test_and_set_full( &( depot->lock ) ) == AO_TS_SET );
+	slab_magazine_t *mag = depot->top;
+
+	if( mag != NULL )
+		depot->top = mag->next;
+
+	AO_CLEAR( &( depot->lock ) );
+
+	return mag;
+}
+
+#endif
+
+inline static size_t _chunk_header( size_t obj_align ) {
+	// header is padded up to alignment of objects
+	return ( sizeof( slab_chunk_t ) + obj_align - 1 ) / obj_align * obj_align;
+}
+
+void slab_init( slab_t *slab, size_t obj_size, size_t obj_align, int node ) {
+	assert( slab != NULL );
+	assert( obj_size > 0 );
+	assert( obj_align > 0 );
+
+	// objects are placed back to back in chunks so size is rounded up to
+	// keep every one of them aligned
+	if( obj_size % obj_align )
+		obj_size = ( obj_size / obj_align + 1 ) * obj_align;
+
+	slab->obj_size = obj_size;
+	slab->obj_align = obj_align;
+	slab->node = node;
+
+	// slack left by rounding up to power of 2 is carved into objects too
+	size_t chunk_sz = _chunk_header( obj_align ) +
+		obj_size * SLAB_CHUNK_OBJECTS;
+
+	for( slab->chunk_size = 1;
+		slab->chunk_size < chunk_sz;
+		slab->chunk_size <<= 1
+	);
+
+	_depot_init( &( slab->full ) );
+	_depot_init( &( slab->empty ) );
+	slab->chunks = 0;
+
+	AO_nop_full();
+}
+
+void slab_cache_init( slab_cache_t *cache ) {
+	assert( cache != NULL );
+
+	memset( cache, 0, sizeof( slab_cache_t ) );
+}
+
+// returns 0 if the chunk can't be mapped; cache is left as it is then
+static int _cache_refill_chunk( slab_t *slab, slab_cache_t *cache ) {
+	size_t header = _chunk_header( slab->obj_align );
+	void *mem = numa_alloc_onnode( slab->chunk_size,
+		slab->chunk_size,
+		slab->node
+	);
+
+	if( mem == NULL )
+		return 0;
+
+	slab_chunk_t *chunk = mem;
+	AO_t head;
+
+	chunk->node = slab->node;
+
+	do {
+		head = AO_load( &( slab->chunks ) );
+		chunk->next = ( slab_chunk_t* ) head;
+	} while(
+		! AO_compare_and_swap_full( &( slab->chunks ), head, ( AO_t ) chunk )
+	);
+
+	cache->chunk_cur = ( ( char* ) mem ) + header;
+	cache->chunk_end = ( ( char* ) mem ) + header +
+		( slab->chunk_size - header ) / slab->obj_size * slab->obj_size;
+
+	return 1;
+}
+
+inline static slab_magazine_t *_magazine_get_empty( slab_t *slab ) {
+	slab_magazine_t *mag = _depot_pop( &( slab->empty ) );
+
+	if( mag == NULL )
+		mag = malloc( sizeof( slab_magazine_t ) );
+
+	mag->count = 0;
+
+	return mag;
+}
+
+void *slab_alloc( slab_t *slab, slab_cache_t *cache ) {
+	assert( slab != NULL );
+	assert( cache != NULL );
+
+	if( ( cache->loaded != NULL ) && ( cache->loaded->count > 0 ) )
+		return cache->loaded->objs[ --cache->loaded->count ];
+
+	if( ( cache->previous != NULL ) && ( cache->previous->count > 0 ) ) {
+		slab_magazine_t *tmp = cache->loaded;
+		cache->loaded = cache->previous;
+		cache->previous = tmp;
+
+		return cache->loaded->objs[ --cache->loaded->count ];
+	}
+
+	// both magazines are empty here; one of them goes back to the depot
+	// and full one is taken instead
+	slab_magazine_t *full = _depot_pop( &( slab->full ) );
+
+	if( full != NULL ) {
+		if( cache->previous != NULL )
+			_depot_push( &( slab->empty ), cache->previous );
+
+		cache->previous = cache->loaded;
+		cache->loaded = full;
+
+		return cache->loaded->objs[ --cache->loaded->count ];
+	}
+
+	if( ( cache->chunk_cur >= cache->chunk_end ) &&
+		! _cache_refill_chunk( slab, cache )
+	)
+		return NULL;
+
+	void *obj = cache->chunk_cur;
+	cache->chunk_cur += slab->obj_size;
+
+	return obj;
+}
+
+void slab_free( slab_t *slab, slab_cache_t *cache, void *obj ) {
+	assert( slab != NULL );
+	assert( cache != NULL );
+	assert( obj != NULL );
+
+	if( cache->loaded == NULL )
+		cache->loaded = _magazine_get_empty( slab );
+
+	if( cache->loaded->count < SLAB_MAGAZINE_SIZE ) {
+		cache->loaded->objs[ cache->loaded->count++ ] = obj;
+		return;
+	}
+
+	if( ( cache->previous != NULL ) && ( cache->previous->count == 0 ) ) {
+		slab_magazine_t *tmp = cache->loaded;
+		cache->loaded = cache->previous;
+		cache->previous = tmp;
+	} else {
+		// both magazines are full; older one is shared with other threads
+		if( cache->previous != NULL )
+			_depot_push( &( slab->full ), cache->previous );
+
+		cache->previous = cache->loaded;
+		cache->loaded = _magazine_get_empty( slab );
+	}
+
+	cache->loaded->objs[ cache->loaded->count++ ] = obj;
+}
+
+// rest of the chunk the thread was carving objects from isn't given back;
+// it's released along with the whole slab
+void slab_cache_flush( slab_t *slab, slab_cache_t *cache ) {
+	assert( slab != NULL );
+	assert( cache != NULL );
+
+	slab_magazine_t *mags[] = { cache->loaded, cache->previous };
+
+	for( int i = 0; i < 2; ++i )
+		if( mags[ i ] != NULL )
+			_depot_push(
+				( mags[ i ]->count > 0 ) ? &( slab->full ) : &( slab->empty ),
+				mags[ i ]
+			);
+
+	slab_cache_init( cache );
+}
+
+// magazines loaded by caches are reachable only from the caches so every
+// cache must have been flushed by now
+void slab_destroy( slab_t *slab ) {
+	assert( slab != NULL );
+
+	slab_magazine_t *mag;
+
+	while( ( mag = _depot_pop( &( slab->full ) ) ) != NULL )
+		free( mag );
+
+	while( ( mag = _depot_pop( &( slab->empty ) ) ) != NULL )
+		free( mag );
+
+	for( slab_chunk_t *chunk = ( slab_chunk_t* ) slab->chunks, *next;
+		chunk != NULL;
+		chunk = next
+	) {
+		next = chunk->next;
+		numa_free( chunk, slab->chunk_size );
+	}
+
+	slab->chunks = 0;
+}
@@ -0,0 +1,85 @@
+#ifndef LIBSLAB
+#define LIBSLAB
+
+#include <stddef.h>
+#include <atomic_ops.h>
+
+// number of objects cached by one magazine
+#ifndef SLAB_MAGAZINE_SIZE
+	#define SLAB_MAGAZINE_SIZE 64
+#endif
+
+// number of objects carved out of one chunk requested from the system
+#ifndef SLAB_CHUNK_OBJECTS
+	#define SLAB_CHUNK_OBJECTS 512
+#endif
+
+// chunks are aligned on their size (power of 2) so the chunk, and the node
+// it was placed on, is found by masking the address of any of its objects
+typedef struct _slab_chunk_t {
+	struct _slab_chunk_t *next;
+	int node;
+} slab_chunk_t;
+
+typedef struct _slab_magazine_t {
+	struct _slab_magazine_t *next;
+	size_t count;
+	void *objs[ SLAB_MAGAZINE_SIZE ];
+} slab_magazine_t;
+
+// lock-free stack of magazines; top pointer is paired with the
+// modification tag against ABA problem
+typedef struct {
+#ifdef AO_HAVE_compare_double_and_swap_double_full
+	volatile AO_double_t top;
+#else
+	volatile AO_TS_t lock;
+	slab_magazine_t *top;
+#endif
+} slab_depot_t;
+
+// allocator of objects of the same size and alignment; objects are cached
+// by threads in magazines (slab_cache_t) and magazines are exchanged
+// between threads through depots; chunks are placed on one NUMA node
+typedef struct {
+	size_t obj_size;
+	size_t obj_align;
+	size_t chunk_size;
+	int node;
+	slab_depot_t full;
+	slab_depot_t empty;
+	// list of the chunks is used only for releasing memory in slab_destroy
+	AO_t chunks;
+} slab_t;
+
+// per-thread part of allocator; it's never touched by other threads
+typedef struct {
+	slab_magazine_t *loaded;
+	slab_magazine_t *previous;
+	char *chunk_cur;
+	char *chunk_end;
+} slab_cache_t;
+
+extern void slab_init( slab_t *slab,
+	size_t obj_size,
+	size_t obj_align,
+	int node
+);
+extern void slab_cache_init( slab_cache_t *cache );
+// returns NULL if a new chunk is needed and can't be mapped
+extern void *slab_alloc( slab_t *slab, slab_cache_t *cache );
+extern void slab_free( slab_t *slab, slab_cache_t *cache, void *obj );
+// gives magazines of the thread back to depots; cache can be used again
+// after that
+extern void slab_cache_flush( slab_t *slab, slab_cache_t *cache );
+// every cache used with the slab must be flushed before the call
+extern void slab_destroy( slab_t *slab );
+
+// node of the slab the object was allocated from
+inline static int slab_node_of( const slab_t *slab, const void *obj ) {
+	return ( ( const slab_chunk_t* ) (
+		( ( AO_t ) obj ) & ~ ( ( AO_t ) slab->chunk_size - 1 )
+	) )->node;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include <utils/spsc.h>
+
+#include <stdlib.h>
+#include <assert.h>
+#include <atomic_ops.h>
+
+#include <reclaim_config.h>
+
+void spsc_init( spsc_t *q, size_t capacity ) {
+	assert( q != NULL );
+	assert( capacity > 0 );
+
+	size_t cap = 1;
+	while( cap < capacity )
+		cap <<= 1;
+
+	q->capacity = cap;
+	q->items = malloc( sizeof( void* ) * cap );
+	q->head = 0;
+	q->tail = 0;
+
+	AO_nop_full();
+}
+
+int spsc_push( spsc_t *q, void *item ) {
+	AO_t tail = q->tail;
+
+	if( ( tail - AO_load( &( q->head ) ) ) >= q->capacity )
+		return 0;
+
+	q->items[ tail & ( q->capacity - 1 ) ] = item;
+	// item must be visible before consumer sees new tail
+	AO_nop_full();
+	AO_store( &( q->tail ), tail + 1 );
+
+	return 1;
+}
+
+void *spsc_pop( spsc_t *q ) {
+	AO_t head = q->head;
+
+	if( head == AO_load( &( q->tail ) ) )
+		return NULL;
+
+	AO_nop_full();
+	void *item = q->items[ head & ( q->capacity - 1 ) ];
+	// slot is reused by producer only after consumer has read it
+	AO_nop_full();
+	AO_store( &( q->head ), head + 1 );
+
+	return item;
+}
+
+void spsc_destroy( spsc_t *q ) {
+	assert( q != NULL );
+
+	free( q->items );
+	q->items = NULL;
+	q->capacity = 0;
+}
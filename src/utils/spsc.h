@@ -0,0 +1,30 @@
+#ifndef LIBSPSC
+#define LIBSPSC
+
+#include <stddef.h>
+#include <atomic_ops.h>
+
+#include <utils/cacheline.h>
+
+// bounded lock-free queue with single producer and single consumer;
+// head is written only by consumer, tail only by producer, each one lives
+// on its own cache line
+typedef struct {
+	size_t capacity;
+	void **items;
+	char pad0[ CACHE_LINE_SIZE ];
+	AO_t head;
+	char pad1[ CACHE_LINE_SIZE - sizeof( AO_t ) ];
+	AO_t tail;
+	char pad2[ CACHE_LINE_SIZE - sizeof( AO_t ) ];
+} spsc_t;
+
+// capacity is rounded up to the power of 2
+extern void spsc_init( spsc_t *q, size_t capacity );
+// returns 0 if queue is full
+extern int spsc_push( spsc_t *q, void *item );
+// returns NULL if queue is empty
+extern void *spsc_pop( spsc_t *q );
+extern void spsc_destroy( spsc_t *q );
+
+#endif